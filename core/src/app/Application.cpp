@@ -3,6 +3,7 @@
 
 #include "Input.h"
 #include "core/Common.h"
+#include "core/JobSystem.h"
 #include "core/Log.h"
 #include "core/Profiler.h"
 #include "rend/Device.h"
@@ -12,6 +13,7 @@
 #include "core/Thread.h"
 #include "gui/ImGuiLayer.h"
 #include "physics/Phys.h"
+#include "utils/Benchmarks.h"
 #include "rend/RendRes.h"
 #include "rend/Shader.h"
 #include "typer/Typer.h"
@@ -33,6 +35,7 @@ namespace pbe {
          return;
       }
 
+      JobSystem::Init();
       InitPhysics();
 
       rendres::Init();
@@ -55,6 +58,7 @@ namespace pbe {
       TermGpuPrograms();
 
       TermPhysics();
+      JobSystem::Term();
 
       layerStack.Clear();
 
@@ -171,6 +175,8 @@ namespace pbe {
          sConfigVarsMng.NextFrame(); // todo: use before triggered in that frame
          Profiler::Get().NextFrame();
          ShadersSrcWatcherUpdate();
+         JobSystem::Get().ProcessMainThreadJobs();
+         BenchmarksUpdate();
 
          for (auto* layer : layerStack) {
             layer->OnUpdate(dt);
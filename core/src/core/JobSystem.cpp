@@ -0,0 +1,312 @@
+#include "pch.h"
+#include "JobSystem.h"
+
+#include "Assert.h"
+#include "Log.h"
+#include "optick.h"
+
+
+namespace pbe {
+
+   struct Job {
+      JobFunc func;
+      JobAffinity affinity = JobAffinity::Any;
+
+      // not completed dependencies + 1 while job is scheduling
+      std::atomic_int pendingDependencies = 1;
+
+      std::mutex mutex;
+      bool completed = false; // guarded by mutex
+      std::vector<std::shared_ptr<Job>> dependents; // guarded by mutex
+
+      std::atomic_bool completedFlag = false; // for lock free check
+   };
+
+   static thread_local int tWorkerIdx = -1;
+
+   static JobSystem* sJobSystem = nullptr;
+
+   bool JobHandle::Completed() const {
+      return !job || job->completedFlag.load(std::memory_order_acquire);
+   }
+
+   void JobSystem::Init(int nWorkers) {
+      ASSERT(!sJobSystem);
+      sJobSystem = new JobSystem();
+
+      if (nWorkers < 0) {
+         nWorkers = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+      }
+      sJobSystem->Start(nWorkers);
+
+      INFO("Job system init with {} workers", nWorkers);
+   }
+
+   void JobSystem::Term() {
+      if (sJobSystem) {
+         sJobSystem->Stop();
+      }
+      SAFE_DELETE(sJobSystem);
+   }
+
+   JobSystem& JobSystem::Get() {
+      ASSERT(sJobSystem);
+      return *sJobSystem;
+   }
+
+   JobHandle JobSystem::Schedule(JobFunc func, std::span<const JobHandle> dependencies, JobAffinity affinity) {
+      auto job = std::make_shared<Job>();
+      job->func = std::move(func);
+      job->affinity = affinity;
+
+      for (const auto& dependency : dependencies) {
+         if (!dependency.job) {
+            continue;
+         }
+
+         std::scoped_lock lock{ dependency.job->mutex };
+         if (!dependency.job->completed) {
+            job->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+            dependency.job->dependents.emplace_back(job);
+         }
+      }
+
+      // remove scheduling guard
+      if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+         Push(job);
+      }
+
+      return JobHandle{ std::move(job) };
+   }
+
+   void JobSystem::Wait(const JobHandle& handle) {
+      while (!handle.Completed()) {
+         if (!ExecuteOne()) {
+            std::this_thread::yield();
+         }
+      }
+   }
+
+   void JobSystem::WaitAll(std::span<const JobHandle> handles) {
+      for (const auto& handle : handles) {
+         Wait(handle);
+      }
+   }
+
+   void JobSystem::ParallelForRange(int begin, int end, int grainSize, const std::function<void(int, int)>& func) {
+      if (begin >= end) {
+         return;
+      }
+
+      grainSize = std::max(grainSize, 1);
+      int nChunks = (end - begin + grainSize - 1) / grainSize;
+
+      if (nChunks == 1 || workers.empty()) {
+         func(begin, end);
+         return;
+      }
+
+      std::vector<JobHandle> handles;
+      handles.reserve(nChunks - 1);
+
+      // first chunk is executed by caller
+      for (int iChunk = 1; iChunk < nChunks; ++iChunk) {
+         int chunkBegin = begin + iChunk * grainSize;
+         int chunkEnd = std::min(chunkBegin + grainSize, end);
+         handles.emplace_back(Schedule([&func, chunkBegin, chunkEnd] { func(chunkBegin, chunkEnd); }));
+      }
+
+      func(begin, std::min(begin + grainSize, end));
+
+      WaitAll(handles);
+   }
+
+   void JobSystem::ProcessMainThreadJobs() {
+      ASSERT(IsMainThread());
+      OPTICK_EVENT("ProcessMainThreadJobs");
+
+      while (auto job = PopMainThread()) {
+         Execute(std::move(job));
+      }
+   }
+
+   void JobSystem::Start(int nWorkers) {
+      mainThreadID = std::this_thread::get_id();
+
+      queues.reserve(nWorkers);
+      for (int i = 0; i < nWorkers; ++i) {
+         queues.emplace_back(std::make_unique<WorkerQueue>());
+      }
+
+      workers.reserve(nWorkers);
+      for (int i = 0; i < nWorkers; ++i) {
+         workers.emplace_back([this, i] { WorkerLoop(i); });
+      }
+   }
+
+   void JobSystem::Stop() {
+      {
+         std::scoped_lock lock{ sleepMutex };
+         stop = true;
+      }
+      sleepCV.notify_all();
+
+      for (auto& worker : workers) {
+         worker.join();
+      }
+      workers.clear();
+      queues.clear();
+   }
+
+   void JobSystem::WorkerLoop(int workerIdx) {
+      tWorkerIdx = workerIdx;
+
+      auto threadName = std::format("Worker {}", workerIdx);
+      OPTICK_THREAD(threadName.c_str());
+
+      while (true) {
+         if (auto job = Pop(workerIdx)) {
+            Execute(std::move(job));
+            continue;
+         }
+
+         // after all ordinary jobs, so long job doesn't delay frame work
+         if (auto job = PopBackground()) {
+            Execute(std::move(job));
+            continue;
+         }
+
+         std::unique_lock lock{ sleepMutex };
+         sleepCV.wait(lock, [this] { return stop || queuedJobs.load() > 0; });
+         if (stop) {
+            break;
+         }
+      }
+   }
+
+   void JobSystem::Push(std::shared_ptr<Job> job) {
+      if (job->affinity == JobAffinity::MainThread) {
+         std::scoped_lock lock{ mainThreadQueue.mutex };
+         mainThreadQueue.jobs.emplace_back(std::move(job));
+         return;
+      }
+
+      if (workers.empty()) {
+         Execute(std::move(job));
+         return;
+      }
+
+      if (job->affinity == JobAffinity::Background) {
+         std::scoped_lock lock{ backgroundQueue.mutex };
+         backgroundQueue.jobs.emplace_back(std::move(job));
+      } else {
+         // worker pushes to own queue, other threads distribute jobs between workers
+         int queueIdx = tWorkerIdx != -1 ? tWorkerIdx : int(pushCounter++ % queues.size());
+         auto& queue = *queues[queueIdx];
+         std::scoped_lock lock{ queue.mutex };
+         queue.jobs.emplace_back(std::move(job));
+      }
+
+      {
+         std::scoped_lock lock{ sleepMutex };
+         ++queuedJobs;
+      }
+      sleepCV.notify_one();
+   }
+
+   std::shared_ptr<Job> JobSystem::Pop(int workerIdx) {
+      int nQueues = (int)queues.size();
+      if (nQueues == 0) {
+         return {};
+      }
+
+      // own queue - newest job
+      if (workerIdx != -1) {
+         auto& queue = *queues[workerIdx];
+         std::scoped_lock lock{ queue.mutex };
+         if (!queue.jobs.empty()) {
+            auto job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            --queuedJobs;
+            return job;
+         }
+      }
+
+      // steal oldest job from others
+      int startIdx = workerIdx != -1 ? workerIdx + 1 : 0;
+      for (int i = 0; i < nQueues; ++i) {
+         int victimIdx = (startIdx + i) % nQueues;
+         if (victimIdx == workerIdx) {
+            continue;
+         }
+
+         auto& queue = *queues[victimIdx];
+         std::scoped_lock lock{ queue.mutex };
+         if (!queue.jobs.empty()) {
+            auto job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            --queuedJobs;
+            return job;
+         }
+      }
+
+      return {};
+   }
+
+   std::shared_ptr<Job> JobSystem::PopMainThread() {
+      std::scoped_lock lock{ mainThreadQueue.mutex };
+      if (mainThreadQueue.jobs.empty()) {
+         return {};
+      }
+      auto job = std::move(mainThreadQueue.jobs.front());
+      mainThreadQueue.jobs.pop_front();
+      return job;
+   }
+
+   std::shared_ptr<Job> JobSystem::PopBackground() {
+      std::scoped_lock lock{ backgroundQueue.mutex };
+      if (backgroundQueue.jobs.empty()) {
+         return {};
+      }
+      auto job = std::move(backgroundQueue.jobs.front());
+      backgroundQueue.jobs.pop_front();
+      --queuedJobs;
+      return job;
+   }
+
+   bool JobSystem::ExecuteOne() {
+      if (IsMainThread()) {
+         if (auto job = PopMainThread()) {
+            Execute(std::move(job));
+            return true;
+         }
+      }
+
+      if (auto job = Pop(tWorkerIdx)) {
+         Execute(std::move(job));
+         return true;
+      }
+
+      return false;
+   }
+
+   void JobSystem::Execute(std::shared_ptr<Job> job) {
+      job->func();
+      job->func = {};
+
+      std::vector<std::shared_ptr<Job>> dependents;
+      {
+         std::scoped_lock lock{ job->mutex };
+         job->completed = true;
+         dependents = std::move(job->dependents);
+      }
+      job->completedFlag.store(true, std::memory_order_release);
+
+      for (auto& dependent : dependents) {
+         if (dependent->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Push(std::move(dependent));
+         }
+      }
+   }
+
+}
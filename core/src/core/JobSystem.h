@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+
+#include "Core.h"
+#include "Common.h"
+
+namespace pbe {
+
+   using JobFunc = std::function<void()>;
+
+   enum class JobAffinity {
+      Any,
+      MainThread, // executed in JobSystem::ProcessMainThreadJobs or while main thread waits
+      Background, // long job (e.g. loading, file writes). Only idle workers take it, waiting threads never execute it
+   };
+
+   struct Job;
+
+   class CORE_API JobHandle {
+   public:
+      JobHandle() = default;
+
+      bool Valid() const { return (bool)job; }
+      bool Completed() const;
+
+      explicit operator bool() const { return Valid(); }
+
+   private:
+      std::shared_ptr<Job> job;
+
+      JobHandle(std::shared_ptr<Job> job) : job(std::move(job)) {}
+
+      friend class JobSystem;
+   };
+
+   // Work stealing scheduler. Each worker has own queue, owner takes newest job, idle workers steal oldest jobs from others.
+   // Waiting thread executes jobs while wait, so it is allowed to wait inside job.
+   // note: Profiler (PROFILE_CPU) is not thread safe, use OPTICK_EVENT inside jobs
+   class CORE_API JobSystem {
+      NON_COPYABLE(JobSystem);
+   public:
+      JobSystem() = default;
+
+      // nWorkers == -1 - hardware threads count minus main thread
+      static void Init(int nWorkers = -1);
+      static void Term();
+      static JobSystem& Get();
+
+      // job will be started after all dependencies are completed
+      JobHandle Schedule(JobFunc func, std::span<const JobHandle> dependencies = {}, JobAffinity affinity = JobAffinity::Any);
+      JobHandle Schedule(JobFunc func, const JobHandle& dependency, JobAffinity affinity = JobAffinity::Any) {
+         return Schedule(std::move(func), std::span{ &dependency, 1 }, affinity);
+      }
+
+      JobHandle ScheduleOnMainThread(JobFunc func, std::span<const JobHandle> dependencies = {}) {
+         return Schedule(std::move(func), dependencies, JobAffinity::MainThread);
+      }
+
+      JobHandle ScheduleBackground(JobFunc func, std::span<const JobHandle> dependencies = {}) {
+         return Schedule(std::move(func), dependencies, JobAffinity::Background);
+      }
+
+      void Wait(const JobHandle& handle);
+      void WaitAll(std::span<const JobHandle> handles);
+
+      // call func(chunkBegin, chunkEnd) for chunks of [begin, end) and wait for completion
+      void ParallelForRange(int begin, int end, int grainSize, const std::function<void(int, int)>& func);
+
+      // call func(idx) for each idx in [begin, end) and wait for completion
+      template<typename Func>
+      void ParallelFor(int begin, int end, int grainSize, Func&& func) {
+         ParallelForRange(begin, end, grainSize, [&func](int chunkBegin, int chunkEnd) {
+            for (int i = chunkBegin; i < chunkEnd; ++i) {
+               func(i);
+            }
+         });
+      }
+
+      // call it from main thread once per frame
+      void ProcessMainThreadJobs();
+
+      int WorkersCount() const { return (int)workers.size(); }
+      bool IsMainThread() const { return std::this_thread::get_id() == mainThreadID; }
+
+   private:
+      struct WorkerQueue {
+         std::mutex mutex;
+         std::deque<std::shared_ptr<Job>> jobs;
+      };
+
+      std::vector<std::thread> workers;
+      std::vector<std::unique_ptr<WorkerQueue>> queues;
+      WorkerQueue mainThreadQueue;
+      WorkerQueue backgroundQueue;
+
+      std::thread::id mainThreadID;
+
+      std::mutex sleepMutex;
+      std::condition_variable sleepCV;
+      std::atomic_int queuedJobs = 0;
+      std::atomic_uint pushCounter = 0;
+      std::atomic_bool stop = false;
+
+      void Start(int nWorkers);
+      void Stop();
+
+      void WorkerLoop(int workerIdx);
+
+      void Push(std::shared_ptr<Job> job);
+      std::shared_ptr<Job> Pop(int workerIdx);
+      std::shared_ptr<Job> PopMainThread();
+      std::shared_ptr<Job> PopBackground();
+
+      // execute one pending job, returns false if there is nothing to do
+      bool ExecuteOne();
+      void Execute(std::shared_ptr<Job> job);
+   };
+
+}
@@ -1,20 +1,41 @@
 #include "pch.h"
 #include "StringID.h"
 
+#include <mutex>
+
 
 namespace pbe {
 
-   // todo: slow hash function
-   static std::unordered_map<std::string, int> sStringIDs;
+   // deque doesn't move elements on push_back, so string_view keys and c_str pointers stay valid
+   static std::deque<std::string> sStrings;
+   static std::unordered_map<std::string_view, int> sStringIDs;
+   static std::mutex sStringIDsMutex;
 
    StringID::StringID(std::string_view str) {
-      auto it = sStringIDs.find(str.data());
+      std::scoped_lock lock{ sStringIDsMutex };
+
+      auto it = sStringIDs.find(str);
       if (it == sStringIDs.end()) {
-         id = (int)sStringIDs.size();
-         sStringIDs[str.data()] = id;
+         id = (int)sStrings.size();
+         const auto& interned = sStrings.emplace_back(str);
+         sStringIDs[interned] = id;
+         this->str = interned.c_str();
       } else {
          id = it->second;
+         this->str = sStrings[id].c_str();
+      }
+   }
+
+   StringID StringID::Find(std::string_view str) {
+      std::scoped_lock lock{ sStringIDsMutex };
+
+      StringID result;
+      auto it = sStringIDs.find(str);
+      if (it != sStringIDs.end()) {
+         result.id = it->second;
+         result.str = sStrings[it->second].c_str();
       }
+      return result;
    }
 
 }
@@ -1,16 +1,30 @@
 #pragma once
 
+#include "Core.h"
+
 namespace pbe {
 
-   class StringID {
+   // interned string: equal strings have equal id, string storage lives until app exit
+   class CORE_API StringID {
    public:
       StringID() = default;
       StringID(std::string_view str);
 
+      // existing id or invalid, doesn't intern str
+      static StringID Find(std::string_view str);
+
       int GetID() const { return id; }
+      bool Valid() const { return id != -1; }
+
+      const char* CStr() const { return str; }
+      std::string_view Str() const { return str; }
+
+      bool operator==(const StringID& rhs) const { return id == rhs.id; }
+      bool operator!=(const StringID& rhs) const { return id != rhs.id; }
 
    private:
       int id = -1;
+      const char* str = "";
    };
 
 }
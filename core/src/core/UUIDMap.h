@@ -0,0 +1,206 @@
+#pragma once
+
+#include <limits>
+#include <span>
+
+#include "Core.h"
+#include "Assert.h"
+#include "UUID.h"
+
+namespace pbe {
+
+   // Open addressing hash map for 64 bit keys with linear probing, all slots are in one array.
+   // EMPTY_KEY (UUID_INVALID) marks empty slot and can't be used as key.
+   template<typename Value>
+   class UUIDMap {
+   public:
+      static constexpr uint64 EMPTY_KEY = std::numeric_limits<uint64>::max();
+
+      UUIDMap() = default;
+
+      uint Size() const { return size; }
+      bool Empty() const { return size == 0; }
+
+      void Clear() {
+         slots.clear();
+         size = 0;
+         shift = 64;
+      }
+
+      void Reserve(uint nElements) {
+         uint capacity = 16;
+         while (capacity * 3 < nElements * 4) {
+            capacity *= 2;
+         }
+
+         if (capacity > Capacity()) {
+            Rehash(capacity);
+         }
+      }
+
+      Value* Find(uint64 key) {
+         return const_cast<Value*>(std::as_const(*this).Find(key));
+      }
+
+      const Value* Find(uint64 key) const {
+         if (size == 0) {
+            return nullptr;
+         }
+
+         uint mask = Capacity() - 1;
+         for (uint i = Home(key); ; i = (i + 1) & mask) {
+            const auto& slot = slots[i];
+            if (slot.key == key) {
+               return &slot.value;
+            }
+            if (slot.key == EMPTY_KEY) {
+               return nullptr;
+            }
+         }
+      }
+
+      bool Contains(uint64 key) const { return Find(key) != nullptr; }
+
+      // values[i] = Find(keys[i]). home slots of a group are computed first, so their loads overlap
+      void FindBatch(std::span<const UUID> keys, std::span<Value*> values) {
+         ASSERT(keys.size() == values.size());
+
+         if (size == 0) {
+            std::ranges::fill(values, nullptr);
+            return;
+         }
+
+         constexpr int GROUP_SIZE = 16;
+         uint homes[GROUP_SIZE];
+
+         uint mask = Capacity() - 1;
+         for (size_t groupBegin = 0; groupBegin < keys.size(); groupBegin += GROUP_SIZE) {
+            int groupSize = (int)std::min(keys.size() - groupBegin, (size_t)GROUP_SIZE);
+
+            for (int i = 0; i < groupSize; ++i) {
+               homes[i] = Home(keys[groupBegin + i]);
+            }
+
+            for (int i = 0; i < groupSize; ++i) {
+               uint64 key = keys[groupBegin + i];
+               Value* value = nullptr;
+
+               for (uint iSlot = homes[i]; ; iSlot = (iSlot + 1) & mask) {
+                  auto& slot = slots[iSlot];
+                  if (slot.key == key) {
+                     value = &slot.value;
+                     break;
+                  }
+                  if (slot.key == EMPTY_KEY) {
+                     break;
+                  }
+               }
+
+               values[groupBegin + i] = value;
+            }
+         }
+      }
+
+      // insert default value if key doesn't exist
+      Value& operator[](uint64 key) {
+         ASSERT(key != EMPTY_KEY);
+
+         if ((size + 1) * 4 > Capacity() * 3) {
+            Rehash(std::max(Capacity() * 2, 16u));
+         }
+
+         uint mask = Capacity() - 1;
+         for (uint i = Home(key); ; i = (i + 1) & mask) {
+            auto& slot = slots[i];
+            if (slot.key == key) {
+               return slot.value;
+            }
+            if (slot.key == EMPTY_KEY) {
+               slot.key = key;
+               ++size;
+               return slot.value;
+            }
+         }
+      }
+
+      bool Erase(uint64 key) {
+         if (size == 0) {
+            return false;
+         }
+
+         uint mask = Capacity() - 1;
+
+         uint hole = Home(key);
+         while (slots[hole].key != key) {
+            if (slots[hole].key == EMPTY_KEY) {
+               return false;
+            }
+            hole = (hole + 1) & mask;
+         }
+
+         // backward shift: move following elements to the hole if it is between their home and current slot
+         for (uint i = (hole + 1) & mask; slots[i].key != EMPTY_KEY; i = (i + 1) & mask) {
+            uint home = Home(slots[i].key);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+               slots[hole] = std::move(slots[i]);
+               hole = i;
+            }
+         }
+
+         slots[hole] = Slot{};
+         --size;
+         return true;
+      }
+
+      // func(UUID key, Value& value)
+      template<typename Func>
+      void ForEach(Func&& func) {
+         for (auto& slot : slots) {
+            if (slot.key != EMPTY_KEY) {
+               func(UUID{ slot.key }, slot.value);
+            }
+         }
+      }
+
+   private:
+      struct Slot {
+         uint64 key = EMPTY_KEY;
+         Value value{};
+      };
+
+      std::vector<Slot> slots;
+      uint size = 0;
+      uint shift = 64; // 64 - log2(capacity)
+
+      uint Capacity() const { return (uint)slots.size(); }
+
+      // fibonacci hashing, high bits are well mixed
+      uint Home(uint64 key) const {
+         return (uint)((key * 0x9E3779B97F4A7C15ull) >> shift);
+      }
+
+      void Rehash(uint capacity) {
+         auto oldSlots = std::move(slots);
+         slots = std::vector<Slot>(capacity);
+
+         shift = 64;
+         for (uint c = capacity; c > 1; c >>= 1) {
+            --shift;
+         }
+
+         uint mask = capacity - 1;
+         for (auto& oldSlot : oldSlots) {
+            if (oldSlot.key == EMPTY_KEY) {
+               continue;
+            }
+
+            uint i = Home(oldSlot.key);
+            while (slots[i].key != EMPTY_KEY) {
+               i = (i + 1) & mask;
+            }
+            slots[i] = std::move(oldSlot);
+         }
+      }
+   };
+
+}
@@ -3,6 +3,7 @@
 
 #include "scene/Entity.h"
 #include "PhysUtils.h"
+#include "core/JobSystem.h"
 #include "core/Log.h"
 
 
@@ -14,7 +15,23 @@ namespace pbe {
    static PxDefaultErrorCallback	gErrorCallback;
    static PxFoundation* gFoundation = NULL;
    static PxPhysics* gPhysics = NULL;
-   static PxDefaultCpuDispatcher* gDispatcher = NULL;
+
+   // physx tasks are executed by engine job system
+   class JobSystemCpuDispatcher : public PxCpuDispatcher {
+   public:
+      void submitTask(PxBaseTask& task) override {
+         JobSystem::Get().Schedule([&task] {
+            task.run();
+            task.release();
+         });
+      }
+
+      uint32_t getWorkerCount() const override {
+         return (uint32_t)JobSystem::Get().WorkersCount();
+      }
+   };
+
+   static JobSystemCpuDispatcher* gDispatcher = NULL;
    static PxMaterial* gMaterial = NULL;
    static PxPvd* gPvd = NULL;
 
@@ -26,12 +43,12 @@ namespace pbe {
       gPvd->connect(*transport, PxPvdInstrumentationFlag::eALL);
 
       gPhysics = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale(), true, gPvd);
-      gDispatcher = PxDefaultCpuDispatcherCreate(2);
+      gDispatcher = new JobSystemCpuDispatcher();
       gMaterial = gPhysics->createMaterial(0.5f, 0.5f, 0.25f);
    }
 
    void TermPhysics() {
-      PX_RELEASE(gDispatcher);
+      SAFE_DELETE(gDispatcher);
       PX_RELEASE(gPhysics);
       if (gPvd) {
          PxPvdTransport* transport = gPvd->getTransport();
@@ -33,6 +33,9 @@ namespace pbe {
 
    PhysicsScene::~PhysicsScene() {
       ASSERT(pxScene->getNbActors(PxActorTypeFlag::eRIGID_STATIC | PxActorTypeFlag::eRIGID_DYNAMIC) == 0);
+      for (auto& [_, shape] : rigidShapes) {
+         shape->release();
+      }
       delete pxScene->getSimulationEventCallback();
       PX_RELEASE(pxScene);
    }
@@ -82,16 +85,31 @@ namespace pbe {
    }
 
    void PhysicsScene::SyncPhysicsWithScene() {
-      for (auto [_, trans, trigger] :
-         scene.View<SceneTransformComponent, TriggerComponent, TransformChangedMarker>().each()) {
-         trigger.pxRigidActor->setGlobalPose(GetTransform(trans));
-      }
+      const auto* transformVersions = scene.GetChangeVersions(GetTypeID<SceneTransformComponent>());
 
-      for (auto [_, trans, rb] :
-         scene.View<SceneTransformComponent, RigidBodyComponent, TransformChangedMarker>().each()) {
-         rb.pxRigidActor->setGlobalPose(GetTransform(trans));
-         PxWakeUp(rb.pxRigidActor);
-      }
+      scene.ForEachChangedSince<SceneTransformComponent>(syncedVersion, [&](entt::entity e) {
+         Entity entity{ e, &scene };
+         if (!entity) {
+            return;
+         }
+
+         uint version = transformVersions->Get(e);
+         if (version >= posedBegin && version < posedEnd) {
+            return;
+         }
+
+         // disabled entities don't have actors
+         if (auto* trigger = entity.TryGet<TriggerComponent>(); trigger && trigger->pxRigidActor) {
+            trigger->pxRigidActor->setGlobalPose(GetTransform(entity.GetTransform()));
+         }
+
+         if (auto* rb = entity.TryGet<RigidBodyComponent>(); rb && rb->pxRigidActor) {
+            rb->pxRigidActor->setGlobalPose(GetTransform(entity.GetTransform()));
+            PxWakeUp(rb->pxRigidActor);
+         }
+      });
+
+      syncedVersion = scene.NextChangeVersion();
    }
 
    void PhysicsScene::Simulate(float dt) {
@@ -103,6 +121,9 @@ namespace pbe {
          steps = 2;
       }
 
+      // own change version for poses from physics, so world cache sees them and sync skips them
+      posedBegin = scene.NextChangeVersion() + 1;
+
       for (int i = 0; i < steps; ++i) {
          pxScene->simulate(stepTimer.GetActTime());
          pxScene->fetchResults(true);
@@ -111,6 +132,8 @@ namespace pbe {
 
          scene.DestroyDelayedEntities();
       }
+
+      posedEnd = scene.NextChangeVersion() + 1;
    }
 
    void PhysicsScene::UpdateSceneAfterPhysics() {
@@ -144,37 +167,47 @@ namespace pbe {
       registry.on_update<JointComponent>().connect<&PhysicsScene::OnUpdateJoint>(this);
    }
 
-   void PhysicsScene::OnEntityEnable() {
-      for (auto e : pScene->ViewAll<GeometryComponent, RigidBodyComponent, DelayedEnableMarker>()) {
-         Entity entity{ e, &scene };
-         AddRigidActor(entity);
+   void PhysicsScene::OnEntityEnable(std::span<const entt::entity> entities) {
+      std::vector<entt::entity> rigidBodies;
+      for (auto e : entities) {
+         if (Entity{ e, &scene }.Has<GeometryComponent, RigidBodyComponent>()) {
+            rigidBodies.emplace_back(e);
+         }
       }
+      AddRigidActors(rigidBodies);
 
-      for (auto e : pScene->ViewAll<GeometryComponent, TriggerComponent, DelayedEnableMarker>()) {
+      for (auto e : entities) {
          Entity entity{ e, &scene };
-         AddTrigger(entity);
+         if (entity.Has<GeometryComponent, TriggerComponent>()) {
+            AddTrigger(entity);
+         }
       }
 
-      for (auto e : pScene->ViewAll<JointComponent, DelayedEnableMarker>()) {
+      // joints are added after all actors, they reference other bodies
+      for (auto e : entities) {
          Entity entity{ e, &scene };
-         AddJoint(entity);
+         if (entity.Has<JointComponent>()) {
+            AddJoint(entity);
+         }
       }
    }
 
-   void PhysicsScene::OnEntityDisable() {
-      for (auto e : pScene->ViewAll<RigidBodyComponent, DelayedDisableMarker>()) {
+   void PhysicsScene::OnEntityDisable(std::span<const entt::entity> entities) {
+      for (auto e : entities) {
          Entity entity{ e, &scene };
-         RemoveRigidActor(entity);
-      }
-
-      for (auto e : pScene->ViewAll<TriggerComponent, DelayedDisableMarker>()) {
-         Entity entity{ e, &scene };
-         RemoveTrigger(entity);
+         if (entity.Has<RigidBodyComponent>()) {
+            RemoveRigidActor(entity);
+         }
+         if (entity.Has<TriggerComponent>()) {
+            RemoveTrigger(entity);
+         }
       }
 
-      for (auto e : pScene->ViewAll<JointComponent, DelayedDisableMarker>()) {
+      for (auto e : entities) {
          Entity entity{ e, &scene };
-         RemoveJoint(entity);
+         if (entity.Has<JointComponent>()) {
+            RemoveJoint(entity);
+         }
       }
    }
 
@@ -182,23 +215,22 @@ namespace pbe {
       Simulate(dt);
    }
 
-   static PxRigidActor* CreateSceneRigidActor(PxScene* pxScene, Entity entity) {
+   // actor is not added to scene
+   static PxRigidActor* CreateSceneRigidActor(Entity entity, PxShape& shape) {
       // todo: pass as function argument
-      auto [trans, geom, rb] = entity.Get<SceneTransformComponent, GeometryComponent, RigidBodyComponent>();
+      auto [trans, rb] = entity.Get<SceneTransformComponent, RigidBodyComponent>();
 
-      PxGeometryHolder physGeom = GetPhysGeom(trans, geom);
       PxTransform physTrans = GetTransform(trans);
 
       PxRigidActor* actor = nullptr;
       if (rb.dynamic) {
          // todo: density, damping
-         actor = PxCreateDynamic(*GetPxPhysics(), physTrans, physGeom.any(), *GetPxMaterial(), 10.0f);
+         actor = PxCreateDynamic(*GetPxPhysics(), physTrans, shape, 10.0f);
       } else {
-         actor = PxCreateStatic(*GetPxPhysics(), physTrans, physGeom.any(), *GetPxMaterial());
+         actor = PxCreateStatic(*GetPxPhysics(), physTrans, shape);
       }
 
       actor->userData = new Entity{ entity }; // todo: use fixed allocator
-      pxScene->addActor(*actor);
 
       return actor;
    }
@@ -209,10 +241,49 @@ namespace pbe {
       pxRigidActor->userData = nullptr;
    }
 
+   size_t PhysicsScene::RigidShapeKeyHash::operator()(const RigidShapeKey& key) const {
+      size_t hash = std::hash<int>{}(key.geomType);
+      for (int i = 0; i < 3; ++i) {
+         hash ^= std::hash<float>{}(key.geomSize[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+         hash ^= std::hash<float>{}(key.scale[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      }
+      return hash;
+   }
+
+   PxShape* PhysicsScene::GetRigidShape(Entity entity) {
+      auto [trans, geom] = entity.Get<SceneTransformComponent, GeometryComponent>();
+
+      if (rigidShapes.size() >= rigidShapesPruneSize) {
+         PruneRigidShapes();
+      }
+
+      RigidShapeKey key{ (int)geom.type, geom.sizeData, trans.Scale() };
+      auto& shape = rigidShapes[key];
+
+      if (!shape) {
+         PxGeometryHolder physGeom = GetPhysGeom(trans, geom);
+         shape = GetPxPhysics()->createShape(physGeom.any(), *GetPxMaterial(), false);
+      }
+
+      return shape;
+   }
+
+   void PhysicsScene::PruneRigidShapes() {
+      // shapes referenced only by cache
+      std::erase_if(rigidShapes, [](auto& it) {
+         if (it.second->getReferenceCount() > 1) {
+            return false;
+         }
+         it.second->release();
+         return true;
+      });
+      rigidShapesPruneSize = std::max<size_t>(64, rigidShapes.size() * 2);
+   }
+
    void PhysicsScene::AddRigidActor(Entity entity) {
-      // todo: pass as function argument
-      auto [trans, geom, rb] = entity.Get<SceneTransformComponent, GeometryComponent, RigidBodyComponent>();
-      PxRigidActor* actor = CreateSceneRigidActor(pxScene, entity);
+      auto& rb = entity.Get<RigidBodyComponent>();
+      PxRigidActor* actor = CreateSceneRigidActor(entity, *GetRigidShape(entity));
+      pxScene->addActor(*actor);
 
       ASSERT(!rb.pxRigidActor);
       rb.pxRigidActor = actor;
@@ -220,6 +291,27 @@ namespace pbe {
       rb.SetData();
    }
 
+   void PhysicsScene::AddRigidActors(std::span<const entt::entity> entities) {
+      std::vector<PxActor*> actors;
+      actors.reserve(entities.size());
+
+      for (auto e : entities) {
+         Entity entity{ e, &scene };
+         auto& rb = entity.Get<RigidBodyComponent>();
+         PxRigidActor* actor = CreateSceneRigidActor(entity, *GetRigidShape(entity));
+
+         ASSERT(!rb.pxRigidActor);
+         rb.pxRigidActor = actor;
+
+         rb.SetData();
+
+         actors.emplace_back(actor);
+      }
+
+      // one scene insertion for all actors
+      pxScene->addActors(actors.data(), (PxU32)actors.size());
+   }
+
    void PhysicsScene::RemoveRigidActor(Entity entity) {
       auto& rb = entity.Get<RigidBodyComponent>();
       if (!rb.pxRigidActor) {
@@ -236,7 +328,8 @@ namespace pbe {
       bool isDynamic = rb.pxRigidActor->is<PxRigidDynamic>();
       bool isDynamicChanged = isDynamic != rb.dynamic;
       if (isDynamicChanged) {
-         PxRigidActor* newActor = CreateSceneRigidActor(pxScene, entity);
+         PxRigidActor* newActor = CreateSceneRigidActor(entity, *GetRigidShape(entity));
+         pxScene->addActor(*newActor);
 
          PxU32 nbConstrains = rb.pxRigidActor->getNbConstraints();
 
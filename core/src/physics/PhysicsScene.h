@@ -27,9 +27,11 @@ namespace pbe {
       void UpdateSceneAfterPhysics();
 
       void OnSetEventHandlers(entt::registry& registry) override;
-      void OnEntityEnable() override;
-      void OnEntityDisable() override;
+      void OnEntityEnable(std::span<const entt::entity> entities) override;
+      void OnEntityDisable(std::span<const entt::entity> entities) override;
 
+      const char* GetName() const override { return "Physics"; }
+      // exclusive: simulation destroys delayed entities
       void OnUpdate(float dt) override;
 
    private:
@@ -38,7 +40,33 @@ namespace pbe {
 
       TimedAction stepTimer{60.f};
 
+      // transforms changed after this scene change version are not synced to actors yet
+      uint syncedVersion = 0;
+      // transforms changed in [posedBegin, posedEnd) are posed by the last simulation, they are not synced back
+      uint posedBegin = 0;
+      uint posedEnd = 0;
+
+      // rigid bodies with equal geometry and world scale use one shape
+      struct RigidShapeKey {
+         int geomType;
+         vec3 geomSize;
+         vec3 scale;
+
+         bool operator==(const RigidShapeKey&) const = default;
+      };
+
+      struct RigidShapeKeyHash {
+         size_t operator()(const RigidShapeKey& key) const;
+      };
+
+      std::unordered_map<RigidShapeKey, physx::PxShape*, RigidShapeKeyHash> rigidShapes;
+      size_t rigidShapesPruneSize = 64;
+
+      physx::PxShape* GetRigidShape(Entity entity);
+      void PruneRigidShapes();
+
       void AddRigidActor(Entity entity);
+      void AddRigidActors(std::span<const entt::entity> entities);
       void RemoveRigidActor(Entity entity);
       void UpdateRigidActor(Entity entity);
 
@@ -0,0 +1,181 @@
+#include "pch.h"
+#include "GpuPack.h"
+
+#include "core/JobSystem.h"
+#include "scene/Scene.h"
+#include "typer/Typer.h"
+
+
+namespace pbe {
+
+   constexpr int cPackElementsPerJob = 4096;
+
+   // offset and type of field by path 'a.b.c'
+   static bool ResolveFieldPath(const TypeInfo& ti, std::string_view path, uint& offset, TypeID& typeID) {
+      const auto& typer = Typer::Get();
+
+      const TypeInfo* cur = &ti;
+      offset = 0;
+
+      while (true) {
+         auto dot = path.find('.');
+         auto name = path.substr(0, dot);
+
+         auto it = std::ranges::find(cur->fields, name, &TypeField::name);
+         if (it == cur->fields.end()) {
+            return false;
+         }
+
+         offset += (uint)it->offset;
+         cur = &typer.GetTypeInfo(it->typeID);
+
+         if (dot == std::string_view::npos) {
+            typeID = it->typeID;
+            return true;
+         }
+         path = path.substr(dot + 1);
+      }
+   }
+
+   bool GpuPacker::Init(TypeID componentTypeID, uint stride, std::span<const GpuPackField> fields) {
+      const auto& typer = Typer::Get();
+
+      typeID = componentTypeID;
+      dstStride = stride;
+      copies.clear();
+
+      const auto& ti = typer.GetTypeInfo(componentTypeID);
+
+      for (const auto& field : fields) {
+         uint srcOffset;
+         TypeID srcTypeID;
+         if (!ResolveFieldPath(ti, field.src, srcOffset, srcTypeID)) {
+            WARN("Component '{}' doesn't have field '{}'", ti.name, field.src);
+            return false;
+         }
+
+         if (srcTypeID != field.typeID) {
+            WARN("Field '{}' of component '{}' has type '{}', gpu field has other type", field.src, ti.name,
+               typer.GetTypeInfo(srcTypeID).name);
+            return false;
+         }
+
+         copies.push_back({ srcOffset, field.dstOffset, field.dstSize });
+      }
+
+      // merge fields adjacent in both structs
+      std::ranges::sort(copies, {}, &Copy::dstOffset);
+
+      std::vector<Copy> merged;
+      for (const auto& copy : copies) {
+         if (!merged.empty()) {
+            auto& last = merged.back();
+            if (last.srcOffset + last.size == copy.srcOffset && last.dstOffset + last.size == copy.dstOffset) {
+               last.size += copy.size;
+               continue;
+            }
+         }
+         merged.emplace_back(copy);
+      }
+      copies = std::move(merged);
+
+      return true;
+   }
+
+   uint GpuPacker::StorageSize(const Scene& scene) const {
+      const auto* ci = Typer::Get().FindComponent(typeID);
+      return ci ? ci->storageView(scene).Size() : 0;
+   }
+
+   // one field of count elements. Size is compile time for common sizes, so copy is plain loads and stores
+   template<uint Size>
+   static void CopyElements(const byte* src, uint srcStride, byte* dst, uint dstStride, uint size, uint count) {
+      const uint valueSize = Size ? Size : size;
+      for (uint i = 0; i < count; ++i, src += srcStride, dst += dstStride) {
+         std::memcpy(dst, src, valueSize);
+      }
+   }
+
+   using CopyElementsFunc = void (*)(const byte* src, uint srcStride, byte* dst, uint dstStride, uint size, uint count);
+
+   static CopyElementsFunc GetCopyElements(uint size) {
+      switch (size) {
+         case 4: return CopyElements<4>;
+         case 8: return CopyElements<8>;
+         case 12: return CopyElements<12>;
+         case 16: return CopyElements<16>;
+         case 64: return CopyElements<64>;
+         default: return CopyElements<0>;
+      }
+   }
+
+   uint GpuPacker::PackStorage(const Scene& scene, byte* dst, std::vector<entt::entity>* entities) const {
+      const auto* ci = Typer::Get().FindComponent(typeID);
+      ASSERT(ci);
+
+      auto view = ci->storageView(scene);
+      uint size = view.Size();
+
+      if (entities) {
+         entities->clear();
+      }
+      if (size == 0) {
+         return 0;
+      }
+
+      const auto* disabled = scene.TryStorage<DisableMarker>();
+      const auto* storageEntities = view.set->data();
+
+      // runs of enabled entities inside one page, split to job size
+      struct Run {
+         uint src; // storage index
+         uint dst; // element index
+         uint count;
+      };
+
+      std::vector<Run> runs;
+      uint count = 0;
+
+      for (uint begin = 0; begin < size; ) {
+         uint pageEnd = std::min((begin / view.pageSize + 1) * view.pageSize, size);
+
+         uint end = begin;
+         while (end < pageEnd && !(disabled && disabled->contains(storageEntities[end]))) {
+            ++end;
+         }
+         for (uint i = begin; i < end; i += cPackElementsPerJob) {
+            uint n = std::min(end - i, (uint)cPackElementsPerJob);
+            runs.push_back({ i, count, n });
+            count += n;
+         }
+         if (entities) {
+            entities->insert(entities->end(), storageEntities + begin, storageEntities + end);
+         }
+
+         begin = end;
+         while (begin < pageEnd && disabled && disabled->contains(storageEntities[begin])) {
+            ++begin;
+         }
+      }
+
+      std::vector<CopyElementsFunc> funcs;
+      funcs.reserve(copies.size());
+      for (const auto& copy : copies) {
+         funcs.emplace_back(GetCopyElements(copy.size));
+      }
+
+      JobSystem::Get().ParallelFor(0, (int)runs.size(), 1, [&](int iRun) {
+         const auto& run = runs[iRun];
+         const byte* src = view.At(run.src);
+         byte* element = dst + (size_t)run.dst * dstStride;
+
+         for (size_t i = 0; i < copies.size(); ++i) {
+            const auto& copy = copies[i];
+            funcs[i](src + copy.srcOffset, view.stride, element + copy.dstOffset, dstStride, copy.size, run.count);
+         }
+      });
+
+      return count;
+   }
+
+}
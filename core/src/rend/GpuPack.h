@@ -0,0 +1,103 @@
+#pragma once
+
+#include <span>
+
+#include <entt/entt.hpp>
+
+#include "core/Assert.h"
+#include "core/Core.h"
+#include "core/Type.h"
+#include "math/Types.h"
+
+namespace pbe {
+
+   class Scene;
+
+   // HLSL constant buffer packing, structured buffers accept it too: field is 4 byte aligned and doesn't cross
+   // 16 byte register, fields of 16 bytes and more (matrices, structs) start new register
+   constexpr bool HlslPackingValid(size_t offset, size_t size) {
+      if (offset % 4 != 0 || size % 4 != 0) {
+         return false;
+      }
+      return size >= 16 ? offset % 16 == 0 : offset / 16 == (offset + size - 1) / 16;
+   }
+
+   // component field, copied as bytes to field of gpu struct
+   struct GpuPackField {
+      std::string_view src; // field path in component TypeInfo, e.g. 'light.color'
+      uint dstOffset;
+      uint dstSize;
+      TypeID typeID; // of gpu field, component field must have the same type
+   };
+
+   template<size_t DstOffset, size_t DstSize>
+   GpuPackField MakeGpuPackField(std::string_view src, TypeID typeID) {
+      static_assert(HlslPackingValid(DstOffset, DstSize), "gpu field breaks HLSL packing, fix padding of struct");
+      return { src, (uint)DstOffset, (uint)DstSize, typeID };
+   }
+
+   // srcField - field path of component, dstField - field of gpu struct from hlslCppShared, may be nested.
+   // Offset of gpu field is checked by HLSL packing rules at compile time
+#define GPU_PACK_FIELD(GpuStruct, srcField, dstField) \
+   MakeGpuPackField<offsetof(GpuStruct, dstField), sizeof(std::declval<GpuStruct&>().dstField)>(#srcField, \
+      GetTypeID<std::remove_cvref_t<decltype(std::declval<GpuStruct&>().dstField)>>())
+
+   // Copy plan from component to gpu struct, built once by Typer offsets of component fields.
+   // Fields adjacent in both structs are merged into one copy
+   class CORE_API GpuPacker {
+   public:
+      // false if component field is missing or its type differs from gpu field
+      bool Init(TypeID componentTypeID, uint dstStride, std::span<const GpuPackField> fields);
+
+      // fields of one component, other bytes of dst are not touched
+      void Pack(const byte* component, byte* dst) const {
+         for (const auto& copy : copies) {
+            std::memcpy(dst + copy.dstOffset, component + copy.srcOffset, copy.size);
+         }
+      }
+
+      // size of component storage, upper bound of PackStorage count
+      uint StorageSize(const Scene& scene) const;
+
+      // components of enabled entities in storage order. dst - array of gpu structs, StorageSize elements at least.
+      // Copies go by storage pages, copy by copy, on worker threads. Returns count of packed elements.
+      // entities - optional, entity of each element
+      uint PackStorage(const Scene& scene, byte* dst, std::vector<entt::entity>* entities = nullptr) const;
+
+   private:
+      struct Copy {
+         uint srcOffset;
+         uint dstOffset;
+         uint size;
+      };
+
+      TypeID typeID = InvalidTypeID;
+      uint dstStride = 0;
+      std::vector<Copy> copies;
+   };
+
+   template<typename Component, typename GpuStruct>
+   class GpuPackerT : public GpuPacker {
+      static_assert(sizeof(GpuStruct) % 16 == 0, "gpu struct must be padded to 16 bytes");
+
+   public:
+      // components must be registered, so create it on first use, not on static init
+      GpuPackerT(std::initializer_list<GpuPackField> fields) {
+         bool valid = Init(GetTypeID<Component>(), sizeof(GpuStruct), std::span{ fields.begin(), fields.size() });
+         ASSERT_MESSAGE(valid, "Cant build gpu packer");
+      }
+
+      void Pack(const Component& component, GpuStruct& dst) const {
+         GpuPacker::Pack((const byte*)&component, (byte*)&dst);
+      }
+
+      // dst is resized to count of packed elements
+      uint PackStorage(const Scene& scene, std::vector<GpuStruct>& dst, std::vector<entt::entity>* entities = nullptr) const {
+         dst.resize(StorageSize(scene));
+         uint count = GpuPacker::PackStorage(scene, (byte*)dst.data(), entities);
+         dst.resize(count);
+         return count;
+      }
+   };
+
+}
@@ -8,6 +8,7 @@
 #include "Buffer.h"
 #include "CommandList.h"
 #include "DbgRend.h"
+#include "GpuPack.h"
 #include "NRDDenoiser.h"
 #include "Renderer.h" // todo:
 #include "Shader.h"
@@ -180,6 +181,13 @@ namespace pbe {
 
       uint importanceSampleObjIdx = -1;
 
+      static const GpuPackerT<MaterialComponent, SRTObject> materialPacker{
+         GPU_PACK_FIELD(SRTObject, baseColor, baseColor),
+         GPU_PACK_FIELD(SRTObject, metallic, metallic),
+         GPU_PACK_FIELD(SRTObject, roughness, roughness),
+         GPU_PACK_FIELD(SRTObject, emissivePower, emissivePower),
+      };
+
       std::vector<SRTObject> objs;
 
       std::vector<AABB> aabbs;
@@ -199,10 +207,7 @@ namespace pbe {
          obj.geomType = (int)geom.type;
          obj.halfSize = geom.sizeData / 2.f * scale;
 
-         obj.baseColor = material.baseColor;
-         obj.metallic = material.metallic;
-         obj.roughness = material.roughness;
-         obj.emissivePower = material.emissivePower;
+         materialPacker.Pack(material, obj);
          if (material.emissivePower > 0) {
             importanceSampleObjIdx = (uint)objs.size();
          }
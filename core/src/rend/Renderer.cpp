@@ -2,6 +2,7 @@
 #include "Renderer.h"
 
 #include "DbgRend.h"
+#include "GpuPack.h"
 #include "RendRes.h"
 #include "RTRenderer.h"
 #include "core/CVar.h"
@@ -253,19 +254,20 @@ namespace pbe {
          instanceBuffer = Buffer::Create(bufferDesc);
       }
 
+      static const GpuPackerT<MaterialComponent, SMaterial> materialPacker{
+         GPU_PACK_FIELD(SMaterial, baseColor, baseColor),
+         GPU_PACK_FIELD(SMaterial, roughness, roughness),
+         GPU_PACK_FIELD(SMaterial, metallic, metallic),
+         GPU_PACK_FIELD(SMaterial, emissivePower, emissivePower),
+      };
+
       std::vector<SInstance> instances;
       instances.reserve(renderObjs.size());
       for (auto& [trans, material] : renderObjs) {
-         SMaterial m;
-         m.baseColor = material.baseColor;
-         m.roughness = material.roughness;
-         m.metallic = material.metallic;
-         m.emissivePower = material.emissivePower;
-
          SInstance instance;
          instance.transform = trans.GetMatrix();
          instance.prevTransform = trans.GetPrevMatrix();
-         instance.material = m;
+         materialPacker.Pack(material, instance.material);
          instance.entityID = (uint)trans.entity.GetID();
 
          instances.emplace_back(instance);
@@ -293,9 +295,10 @@ namespace pbe {
 
          if (cUseFrustumCulling) {
             // todo:
-            float sphereRadius = glm::max(sceneTrans.scale.x, sceneTrans.scale.y);
-            sphereRadius = glm::max(sphereRadius, sceneTrans.scale.z) * 2;
-            if (!frustum.SphereTest({ sceneTrans.position, })) {
+            const vec3& scale = sceneTrans.LocalScale();
+            float sphereRadius = glm::max(scale.x, scale.y);
+            sphereRadius = glm::max(sphereRadius, scale.z) * 2;
+            if (!frustum.SphereTest({ sceneTrans.LocalPosition(), })) {
                continue;
             }
          }
@@ -319,17 +322,19 @@ namespace pbe {
             lightBuffer = Buffer::Create(bufferDesc);
          }
 
-         std::vector<SLight> lights;
-         lights.reserve(nLights);
+         static const GpuPackerT<LightComponent, SLight> lightPacker{
+            GPU_PACK_FIELD(SLight, color, color),
+            GPU_PACK_FIELD(SLight, radius, radius),
+         };
 
-         for (auto [e, trans, light] : scene.View<SceneTransformComponent, LightComponent>().each()) {
-            SLight l;
-            l.position = trans.position;
-            l.color = light.color;
-            l.radius = light.radius;
-            l.type = SLIGHT_TYPE_POINT;
+         std::vector<SLight> lights;
+         std::vector<entt::entity> lightEntities;
+         lightPacker.PackStorage(scene, lights, &lightEntities);
 
-            lights.emplace_back(l);
+         auto transforms = scene.View<SceneTransformComponent>();
+         for (size_t i = 0; i < lights.size(); ++i) {
+            lights[i].position = transforms.get<SceneTransformComponent>(lightEntities[i]).Position();
+            lights[i].type = SLIGHT_TYPE_POINT;
          }
 
          cmd.UpdateSubresource(*lightBuffer, lights.data(), 0, lights.size() * sizeof(SLight));
@@ -398,9 +403,9 @@ namespace pbe {
          for (auto [e, trans, decal] : scene.View<SceneTransformComponent, DecalComponent>().each()) {
             decalObjs.emplace_back(trans, decalDefault);
 
-            vec3 size = trans.scale * 0.5f;
+            vec3 size = trans.LocalScale() * 0.5f;
 
-            mat4 view = glm::lookAt(trans.position, trans.position + trans.Forward(), trans.Up());
+            mat4 view = glm::lookAt(trans.LocalPosition(), trans.LocalPosition() + trans.Forward(), trans.Up());
             mat4 projection = glm::ortho(-size.x, size.x, -size.y, size.y, -size.z, size.z);
             mat4 viewProjection = projection * view;
             decals.emplace_back(viewProjection, decal.baseColor, decal.metallic, decal.roughness);
@@ -487,8 +492,8 @@ namespace pbe {
       if (cvRenderOpaqueSort) {
          // todo: slow. I assumed
          std::ranges::sort(opaqueObjs, [&](const RenderObject& a, const RenderObject& b) {
-            float az = glm::dot(camera.Forward(), a.trans.position);
-            float bz = glm::dot(camera.Forward(), b.trans.position);
+            float az = glm::dot(camera.Forward(), a.trans.LocalPosition());
+            float bz = glm::dot(camera.Forward(), b.trans.LocalPosition());
             return az < bz;
          });
       }
@@ -688,8 +693,8 @@ namespace pbe {
             if (cvRenderTransparencySort) {
                // todo: slow. I assumed
                std::ranges::sort(transparentObjs, [&](RenderObject& a, RenderObject& b) {
-                  float az = glm::dot(camera.Forward(), a.trans.position);
-                  float bz = glm::dot(camera.Forward(), b.trans.position);
+                  float az = glm::dot(camera.Forward(), a.trans.LocalPosition());
+                  float bz = glm::dot(camera.Forward(), b.trans.LocalPosition());
                   return az > bz;
                   });
             }
@@ -861,7 +866,7 @@ namespace pbe {
          }
 
          for (auto [e, trans, light] : scene.View<SceneTransformComponent, LightComponent>().each()) {
-            dbgRend.DrawSphere({ trans.position, light.radius }, light.color);
+            dbgRend.DrawSphere({ trans.LocalPosition(), light.radius }, light.color);
          }
 
          for (auto [e, trans, light] : scene.View<SceneTransformComponent, TriggerComponent>().each()) {
@@ -934,7 +939,7 @@ namespace pbe {
 
       for (const auto& [trans, material] : renderObjs) {
          SDrawCallCB cb;
-         cb.instance.transform = glm::translate(mat4(1), trans.position);
+         cb.instance.transform = glm::translate(mat4(1), trans.LocalPosition());
          cb.instance.transform = cb.instance.transform;
          cb.instance.material.roughness = material.roughness;
          cb.instance.material.baseColor = material.baseColor;
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <span>
+
+#include <entt/entt.hpp>
+
+#include "core/Core.h"
+#include "math/Types.h"
+
+namespace pbe {
+
+   // versions of one component type by entity index. Version is scene change version at last change of component.
+   // Marks of different entities may come from different threads, slots are sized by component construction.
+   // Max version of every page of slots lets ForEachChangedSince skip untouched pages
+   class ChangeVersions {
+   public:
+      void Mark(entt::entity entity, uint version) {
+         auto idx = (size_t)entt::to_entity(entity);
+         if (idx >= slots.size()) {
+            Resize(idx + 1);
+         }
+         slots[idx] = { entity, version };
+
+         // only raised, restored older version keeps page max
+         std::atomic_ref<uint> pageVersion{ pageVersions[idx / PageSize] };
+         if (pageVersion.load(std::memory_order_relaxed) < version) {
+            pageVersion.store(version, std::memory_order_relaxed);
+         }
+      }
+
+      // e.g. whole storage after copy
+      void MarkAll(std::span<const entt::entity> entities, uint version) {
+         for (auto entity : entities) {
+            Mark(entity, version);
+         }
+      }
+
+      // 0 if entity was never changed
+      uint Get(entt::entity entity) const {
+         auto idx = (size_t)entt::to_entity(entity);
+         return idx < slots.size() && slots[idx].entity == entity ? slots[idx].version : 0;
+      }
+
+      // func(entt::entity) for entities changed after version. Entity may be already destroyed or lost component
+      template<typename Func>
+      void ForEachChangedSince(uint version, Func&& func) const {
+         for (size_t page = 0; page < pageVersions.size(); ++page) {
+            if (pageVersions[page] <= version) {
+               continue;
+            }
+
+            size_t end = std::min((page + 1) * PageSize, slots.size());
+            for (size_t i = page * PageSize; i < end; ++i) {
+               if (slots[i].version > version) {
+                  func(slots[i].entity);
+               }
+            }
+         }
+      }
+
+   private:
+      static constexpr size_t PageSize = 1024;
+
+      struct Slot {
+         entt::entity entity = entt::null;
+         uint version = 0;
+      };
+
+      std::vector<Slot> slots;
+      std::vector<uint> pageVersions; // max version of slots of page
+
+      void Resize(size_t size) {
+         slots.resize(std::max(size, slots.size() * 2));
+         pageVersions.resize((slots.size() + PageSize - 1) / PageSize);
+      }
+   };
+
+}
@@ -173,33 +173,6 @@ namespace pbe {
       STRUCT_FIELD(color)
    STRUCT_END()
 
-   vec3 SceneTransformComponent::Position() const {
-      vec3 pos = position;
-      if (parent) {
-         auto& pTrans = parent.Get<SceneTransformComponent>();
-         pos = pTrans.Position() + pTrans.Rotation() * (pos * pTrans.Scale());
-      }
-      return pos;
-   }
-
-   quat SceneTransformComponent::Rotation() const {
-      quat rot = rotation;
-      if (parent) {
-         auto& pTrans = parent.Get<SceneTransformComponent>();
-         rot = pTrans.Rotation() * rot;
-      }
-      return rot;
-   }
-
-   vec3 SceneTransformComponent::Scale() const {
-      vec3 s = scale;
-      if (parent) {
-         auto& pTrans = parent.Get<SceneTransformComponent>();
-         s *= pTrans.Scale();
-      }
-      return s;
-   }
-
    void SceneTransformComponent::SetPosition(const vec3& pos) {
       if (HasParent()) {
          auto& pTrans = parent.Get<SceneTransformComponent>();
@@ -207,6 +180,7 @@ namespace pbe {
       } else {
          position = pos;
       }
+      MarkWorldDirty();
    }
 
    void SceneTransformComponent::SetRotation(const quat& rot) {
@@ -216,6 +190,7 @@ namespace pbe {
       } else {
          rotation = rot;
       }
+      MarkWorldDirty();
    }
 
    void SceneTransformComponent::SetScale(const vec3& s) {
@@ -225,6 +200,29 @@ namespace pbe {
       } else {
          scale = s;
       }
+      MarkWorldDirty();
+   }
+
+   void SceneTransformComponent::SetLocalPosition(const vec3& pos) {
+      position = pos;
+      MarkWorldDirty();
+   }
+
+   void SceneTransformComponent::SetLocalRotation(const quat& rot) {
+      rotation = rot;
+      MarkWorldDirty();
+   }
+
+   void SceneTransformComponent::SetLocalScale(const vec3& s) {
+      scale = s;
+      MarkWorldDirty();
+   }
+
+   void SceneTransformComponent::SetLocalTransform(const vec3& pos, const quat& rot, const vec3& s) {
+      position = pos;
+      rotation = rot;
+      scale = s;
+      MarkWorldDirty();
    }
 
    vec3 SceneTransformComponent::Right() const {
@@ -239,13 +237,6 @@ namespace pbe {
       return Rotation() * vec3_Forward;
    }
 
-   mat4 SceneTransformComponent::GetMatrix() const {
-      mat4 transform = glm::translate(mat4(1), Position());
-      transform *= mat4{ Rotation() };
-      transform *= glm::scale(mat4(1), Scale());
-      return transform;
-   }
-
    mat4 SceneTransformComponent::GetPrevMatrix() const {
       mat4 transform = glm::translate(mat4(1), prevPosition);
       transform *= mat4{ prevRotation };
@@ -269,6 +260,24 @@ namespace pbe {
       }
    }
 
+   void SceneTransformComponent::RemapEntities(std::span<const entt::entity> remap, Scene* scene) {
+      auto remapLink = [&](entt::entity& id) {
+         if (id != entt::null) {
+            id = remap[entt::to_entity(id)];
+         }
+      };
+
+      entity = Entity{ remap[entt::to_entity(entity.GetID())], scene };
+      if (parent) {
+         parent = Entity{ remap[entt::to_entity(parent.GetID())], scene };
+      }
+
+      remapLink(firstChild);
+      remapLink(lastChild);
+      remapLink(prevSibling);
+      remapLink(nextSibling);
+   }
+
    void SceneTransformComponent::SetMatrix(const mat4& transform) {
       auto [position_, rotation_, scale_] = GetTransformDecomposition(transform);
 
@@ -278,6 +287,61 @@ namespace pbe {
       SetScale(scale_);
    }
 
+   void SceneTransformComponent::MarkWorldDirty() {
+      // every change is versioned, children only when they become dirty
+      if (Scene* scene = entity.GetScene()) {
+         scene->MarkTransformChanged(entity.GetID());
+      }
+
+      // children of dirty transform are already dirty
+      if (worldDirty) {
+         return;
+      }
+      worldDirty = true;
+
+      for (auto child : Children()) {
+         child.GetTransform().MarkWorldDirty();
+      }
+   }
+
+   void SceneTransformComponent::UpdateWorld() const {
+      if (parent) {
+         parent.Get<SceneTransformComponent>().UpdateWorldIfDirty();
+      }
+
+      auto world = CalcWorld();
+      worldPosition = world.position;
+      worldRotation = world.rotation;
+      worldScale = world.scale;
+      worldMatrix = world.Matrix();
+
+      worldDirty = false;
+   }
+
+   SceneTransformComponent::WorldTransform SceneTransformComponent::CalcWorld() const {
+      if (!parent) {
+         return { position, rotation, scale };
+      }
+
+      auto& pTrans = parent.Get<SceneTransformComponent>();
+      auto pWorld = pTrans.worldDirty
+         ? pTrans.CalcWorld()
+         : WorldTransform{ pTrans.worldPosition, pTrans.worldRotation, pTrans.worldScale };
+
+      return {
+         pWorld.position + pWorld.rotation * (position * pWorld.scale),
+         pWorld.rotation * rotation,
+         scale * pWorld.scale,
+      };
+   }
+
+   mat4 SceneTransformComponent::WorldTransform::Matrix() const {
+      mat4 transform = glm::translate(mat4(1), position);
+      transform *= mat4{ rotation };
+      transform *= glm::scale(mat4(1), scale);
+      return transform;
+   }
+
    void SceneTransformComponent::UpdatePrevTransform() {
       prevPosition = Position();
       prevRotation = Rotation();
@@ -289,15 +353,14 @@ namespace pbe {
    }
 
    void SceneTransformComponent::RemoveChild(int idx) {
-      ASSERT(idx >= 0 && idx < children.size());
-      children[idx].Get<SceneTransformComponent>().SetParent(); // todo: mb set to scene root?
+      ASSERT(idx >= 0 && idx < nChildren);
+      GetChild(idx).GetTransform().SetParent(); // todo: mb set to scene root?
    }
 
    void SceneTransformComponent::RemoveAllChild(Entity theirNewParent) {
-      for (int i = (int)children.size() - 1; i >= 0; --i) {
-         children[i].Get<SceneTransformComponent>().SetParent(theirNewParent);
+      while (HasChilds()) {
+         FirstChild().GetTransform().SetParent(theirNewParent);
       }
-      ASSERT(!HasChilds());
    }
 
    bool SceneTransformComponent::SetParent(Entity newParent, int iChild, bool keepLocalTransform) {
@@ -313,12 +376,14 @@ namespace pbe {
          return false;
       }
 
+      if (!keepLocalTransform) {
+         UpdateWorldIfDirty();
+      }
       auto pos = Position();
       auto rot = Rotation();
       auto scale = Scale();
 
       if (HasParent()) {
-         auto& pTrans = parent.Get<SceneTransformComponent>();
          if (parent == newParent) {
             int idx = GetChildIdx();
             if (idx < iChild) {
@@ -327,18 +392,14 @@ namespace pbe {
                return false;
             }
          }
-         std::erase(pTrans.children, entity);
+         UnlinkFromParent();
       }
 
       parent = newParent;
-      if (parent) {
-         auto& pTrans = parent.Get<SceneTransformComponent>();
+      MarkWorldDirty();
 
-         if (iChild == -1) {
-            pTrans.children.push_back(entity);
-         } else {
-            pTrans.children.insert(pTrans.children.begin() + iChild, entity);
-         }
+      if (parent) {
+         LinkToParent(iChild);
       }
 
       if (!keepLocalTransform) {
@@ -351,8 +412,86 @@ namespace pbe {
    }
 
    int SceneTransformComponent::GetChildIdx() const {
-      auto& pTrans = parent.Get<SceneTransformComponent>();
-      return (int)std::ranges::distance(pTrans.children.begin(), std::ranges::find(pTrans.children, entity));
+      int idx = 0;
+      for (auto sibling = PrevSibling(); sibling; sibling = sibling.GetTransform().PrevSibling()) {
+         ++idx;
+      }
+      return idx;
+   }
+
+   Entity SceneTransformComponent::GetChild(int idx) const {
+      if (idx < 0 || idx >= nChildren) {
+         return {};
+      }
+
+      Entity child = FirstChild();
+      while (idx-- > 0) {
+         child = child.GetTransform().NextSibling();
+      }
+      return child;
+   }
+
+   Entity SceneTransformComponent::NextInHierarchy(const Entity& subtreeRoot, bool skipChildren) const {
+      if (!skipChildren && firstChild != entt::null) {
+         return FirstChild();
+      }
+
+      const SceneTransformComponent* trans = this;
+      while (trans->entity != subtreeRoot) {
+         if (trans->nextSibling != entt::null) {
+            return trans->NextSibling();
+         }
+         trans = &trans->parent.GetTransform();
+      }
+
+      return {};
+   }
+
+   void SceneTransformComponent::LinkToParent(int iChild) {
+      ASSERT(prevSibling == entt::null && nextSibling == entt::null);
+
+      auto& pTrans = parent.GetTransform();
+      const auto id = entity.GetID();
+
+      // insert before 'next' or to the end
+      Entity next = iChild == -1 ? Entity{} : pTrans.GetChild(iChild);
+      if (next) {
+         auto& nextTrans = next.GetTransform();
+         prevSibling = nextTrans.prevSibling;
+         nextSibling = next.GetID();
+         nextTrans.prevSibling = id;
+      } else {
+         prevSibling = pTrans.lastChild;
+         pTrans.lastChild = id;
+      }
+
+      if (prevSibling != entt::null) {
+         PrevSibling().GetTransform().nextSibling = id;
+      } else {
+         pTrans.firstChild = id;
+      }
+
+      ++pTrans.nChildren;
+   }
+
+   void SceneTransformComponent::UnlinkFromParent() {
+      auto& pTrans = parent.GetTransform();
+
+      if (prevSibling != entt::null) {
+         PrevSibling().GetTransform().nextSibling = nextSibling;
+      } else {
+         pTrans.firstChild = nextSibling;
+      }
+
+      if (nextSibling != entt::null) {
+         NextSibling().GetTransform().prevSibling = prevSibling;
+      } else {
+         pTrans.lastChild = prevSibling;
+      }
+
+      prevSibling = entt::null;
+      nextSibling = entt::null;
+      --pTrans.nChildren;
    }
 
    void SceneTransformComponent::Serialize(Serializer& ser) const {
@@ -363,18 +502,16 @@ namespace pbe {
       ser.Ser("scale", scale);
 
       if (HasParent()) {
-         ser.KeyValue("parent", parent.Get<UUIDComponent>().uuid);
+         ser.KeyValue("parent", (uint64)parent.Get<UUIDComponent>().uuid);
       }
 
       if (HasChilds()) {
          ser.Key("children");
 
-         auto& out = ser.out;
-         out << YAML::Flow;
-         SERIALIZER_SEQ(ser);
+         SERIALIZER_FLOW_SEQ(ser);
 
-         for (auto children : children) {
-            out << (uint64)children.GetUUID();
+         for (auto child : Children()) {
+            ser.out.Value((uint64)child.GetUUID());
          }
       }
    };
@@ -388,16 +525,18 @@ namespace pbe {
       success &= deser.Deser("position", position);
       success &= deser.Deser("rotation", rotation);
       success &= deser.Deser("scale", scale);
+      MarkWorldDirty();
 
       // note: we will be added by our parent
       // auto parent = deser.Deser<uint64>("parent");
 
       if (auto childrenDeser = deser["children"]) {
-         children.reserve(childrenDeser.node.size());
-
          for (auto child : childrenDeser.node) {
             uint64 childUuid = child.as<uint64>(); // todo: check
-            AddChild(entity.GetScene()->GetEntity(childUuid), -1, true);
+            // child may be missing while scene journal is replayed, it restores parent by itself
+            if (Entity childEntity = entity.GetScene()->GetEntity(childUuid)) {
+               AddChild(childEntity, -1, true);
+            }
          }
       }
 
@@ -417,6 +556,10 @@ namespace pbe {
 
       editted |= Vec3UI("Scale", scale, 1, 70);
 
+      if (editted) {
+         MarkWorldDirty();
+      }
+
       return editted;
    }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Entity.h"
+#include "core/StringID.h"
 #include "core/UUID.h"
 #include "math/Types.h"
 
@@ -10,8 +11,9 @@ namespace pbe {
       UUID uuid;
    };
 
+   // change it by Entity::SetName, scene name index is updated on patch
    struct TagComponent {
-      std::string tag;
+      StringID tag;
    };
 
    struct CameraComponent {
@@ -21,7 +23,22 @@ namespace pbe {
    // todo: move to math
    CORE_API std::tuple<glm::vec3, glm::quat, glm::vec3> GetTransformDecomposition(const glm::mat4& transform);
 
-   struct TransformChangedMarker {};
+
+   // iterate over children through sibling links
+   struct ChildIterator {
+      Entity child;
+
+      Entity operator*() const { return child; }
+      ChildIterator& operator++();
+      bool operator==(const ChildIterator&) const = default;
+   };
+
+   struct ChildRange {
+      Entity first;
+
+      ChildIterator begin() const { return { first }; }
+      ChildIterator end() const { return {}; }
+   };
 
    struct CORE_API SceneTransformComponent {
       SceneTransformComponent() = default;
@@ -29,41 +46,64 @@ namespace pbe {
 
       Entity entity;
 
-      // local space
-      vec3 position{};
-      quat rotation = quat_Identity;
-      vec3 scale{ 1.f };
-
       // todo:
       // World Space
       vec3 prevPosition{};
       quat prevRotation = quat_Identity;
       vec3 prevScale{ 1.f };
 
-      // todo: return const ref
-      // World space
-      vec3 Position() const;
-      quat Rotation() const;
-      vec3 Scale() const;
+      // World space. Cached, getters don't update it, so systems with read access may run in parallel.
+      // Cache is updated by Scene::UpdateWorldTransforms: on tick, after every system that writes transforms
+      // and before render. Dirty transform (changed by the same system) is calculated by each call
+      vec3 Position() const { return worldDirty ? CalcWorld().position : worldPosition; }
+      quat Rotation() const { return worldDirty ? CalcWorld().rotation : worldRotation; }
+      vec3 Scale() const { return worldDirty ? CalcWorld().scale : worldScale; }
 
       void SetPosition(const vec3& pos);
       void SetRotation(const quat& rot);
       void SetScale(const vec3& s);
 
+      const vec3& LocalPosition() const { return position; }
+      const quat& LocalRotation() const { return rotation; }
+      const vec3& LocalScale() const { return scale; }
+
+      void SetLocalPosition(const vec3& pos);
+      void SetLocalRotation(const quat& rot);
+      void SetLocalScale(const vec3& s);
+      // by one dirty mark
+      void SetLocalTransform(const vec3& pos, const quat& rot, const vec3& s);
+
       vec3 Right() const;
       vec3 Up() const;
       vec3 Forward() const;
 
-      mat4 GetMatrix() const;
+      mat4 GetMatrix() const { return worldDirty ? CalcWorld().Matrix() : worldMatrix; }
       mat4 GetPrevMatrix() const;
       void SetMatrix(const mat4& transform);
 
+      bool IsWorldDirty() const { return worldDirty; }
+      // marks self and all children
+      void MarkWorldDirty();
+      // recalculate world space cache. Dirty parents are updated first. Writes cache, so only with write access
+      void UpdateWorld() const;
+
       void UpdatePrevTransform(); // todo: call it when first create entity
 
       Entity parent;
-      std::vector<Entity> children;
       bool HasParent() const { return (bool)parent; }
-      bool HasChilds() const { return !children.empty(); }
+      bool HasChilds() const { return nChildren > 0; }
+      int ChildsCount() const { return nChildren; }
+
+      Entity FirstChild() const { return LinkedEntity(firstChild); }
+      Entity LastChild() const { return LinkedEntity(lastChild); }
+      Entity NextSibling() const { return LinkedEntity(nextSibling); }
+      Entity PrevSibling() const { return LinkedEntity(prevSibling); }
+      Entity GetChild(int idx) const;
+      ChildRange Children() const { return { FirstChild() }; }
+
+      // pre-order traversal of subtree with root 'subtreeRoot'. Returns invalid entity at the end.
+      // skipChildren - go to next sibling (or up) without visiting children of this entity
+      Entity NextInHierarchy(const Entity& subtreeRoot, bool skipChildren = false) const;
 
       void AddChild(Entity child, int iChild = -1, bool keepLocalTransform = false);
       void RemoveChild(int idx);
@@ -73,12 +113,68 @@ namespace pbe {
       bool SetParentInternal(Entity newParent = {}, int iChild = -1, bool keepLocalTransform = false);
       int GetChildIdx() const;
 
+      // after storage copy to another scene. remap: src entity index -> dst entity
+      void RemapEntities(std::span<const entt::entity> remap, Scene* scene);
+
       void Serialize(Serializer& ser) const;
       bool Deserialize(const Deserializer& deser);
       bool UI();
+
+   private:
+      template<typename T>
+      friend struct StructFields;
+
+      vec3 position{};
+      quat rotation = quat_Identity;
+      vec3 scale{ 1.f };
+
+      // hierarchy links, all entities are from the same scene as 'entity'
+      entt::entity firstChild{ entt::null };
+      entt::entity lastChild{ entt::null };
+      entt::entity prevSibling{ entt::null };
+      entt::entity nextSibling{ entt::null };
+      int nChildren = 0;
+
+      Entity LinkedEntity(entt::entity id) const {
+         return id == entt::null ? Entity{} : Entity{ id, entity.GetScene() };
+      }
+
+      void LinkToParent(int iChild);
+      void UnlinkFromParent();
+
+      // World space cache. If transform is dirty, all its children are dirty too
+      mutable vec3 worldPosition{};
+      mutable quat worldRotation = quat_Identity;
+      mutable vec3 worldScale{ 1.f };
+      mutable mat4 worldMatrix{ 1.f };
+      mutable bool worldDirty = true;
+
+      struct WorldTransform {
+         vec3 position;
+         quat rotation;
+         vec3 scale;
+
+         mat4 Matrix() const;
+      };
+
+      // by cache of not dirty parents, doesn't write cache
+      WorldTransform CalcWorld() const;
+
+      void UpdateWorldIfDirty() const {
+         if (worldDirty) {
+            UpdateWorld();
+         }
+      }
    };
 
+   inline ChildIterator& ChildIterator::operator++() {
+      child = child.GetTransform().NextSibling();
+      return *this;
+   }
+
    struct MaterialComponent {
+      static constexpr bool SHARED = true;
+
       vec3 baseColor = vec3_One;
       float roughness = 0.1f;
       float metallic = 0;
@@ -114,6 +210,8 @@ namespace pbe {
    };
 
    struct GeometryComponent {
+      static constexpr bool SHARED = true;
+
       GeomType type = GeomType::Box;
       vec3 sizeData = vec3_One; // todo: full size
    };
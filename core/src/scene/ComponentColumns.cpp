@@ -0,0 +1,192 @@
+#include "pch.h"
+#include "ComponentColumns.h"
+
+#include "Entity.h"
+#include "Scene.h"
+#include "core/JobSystem.h"
+#include "typer/Typer.h"
+
+
+namespace pbe {
+
+   constexpr int cColumnRowsPerJob = 4096;
+
+   ComponentColumn* ComponentColumns::Find(std::string_view name) {
+      auto it = std::ranges::find(columns, name, &ComponentColumn::name);
+      return it != columns.end() ? &*it : nullptr;
+   }
+
+   const ComponentColumn* ComponentColumns::Find(std::string_view name) const {
+      auto it = std::ranges::find(columns, name, &ComponentColumn::name);
+      return it != columns.end() ? &*it : nullptr;
+   }
+
+   // rows [begin, end) of one column. Size is compile time for common sizes, so copy is plain loads and stores
+   template<bool Gather, uint Size>
+   static void CopyRows(const ComponentStorageView& view, uint offset, uint size, byte* column, uint begin, uint end) {
+      const uint valueSize = Size ? Size : size;
+      // whole component, rows of page are contiguous in both
+      const bool contiguous = offset == 0 && valueSize == view.stride;
+
+      for (uint i = begin; i < end; ) {
+         uint pageEnd = std::min((i / view.pageSize + 1) * view.pageSize, end);
+
+         byte* component = view.At(i) + offset;
+         byte* value = column + (size_t)i * valueSize;
+
+         if (contiguous) {
+            size_t bytes = (size_t)(pageEnd - i) * valueSize;
+            Gather ? std::memcpy(value, component, bytes) : std::memcpy(component, value, bytes);
+            i = pageEnd;
+            continue;
+         }
+
+         for (; i < pageEnd; ++i, component += view.stride, value += valueSize) {
+            Gather ? std::memcpy(value, component, valueSize) : std::memcpy(component, value, valueSize);
+         }
+      }
+   }
+
+   using CopyRowsFunc = void (*)(const ComponentStorageView&, uint offset, uint size, byte* column, uint begin, uint end);
+
+   template<bool Gather>
+   static CopyRowsFunc GetCopyRows(uint size) {
+      switch (size) {
+         case 4: return CopyRows<Gather, 4>;
+         case 8: return CopyRows<Gather, 8>;
+         case 12: return CopyRows<Gather, 12>;
+         case 16: return CopyRows<Gather, 16>;
+         default: return CopyRows<Gather, 0>;
+      }
+   }
+
+   // rows are storage indices
+   template<bool Gather>
+   static void CopyColumns(const ComponentStorageView& view, std::span<const ComponentColumn> columns, uint rows) {
+      struct Copy {
+         CopyRowsFunc func;
+         uint offset;
+         uint size;
+         byte* data;
+      };
+
+      std::vector<Copy> copies;
+      copies.reserve(columns.size());
+      for (const auto& column : columns) {
+         copies.emplace_back(GetCopyRows<Gather>(column.size), column.offset, column.size, (byte*)column.data.data());
+      }
+
+      JobSystem::Get().ParallelForRange(0, (int)rows, cColumnRowsPerJob, [&](int begin, int end) {
+         for (const auto& copy : copies) {
+            copy.func(view, copy.offset, copy.size, copy.data, (uint)begin, (uint)end);
+         }
+      });
+   }
+
+   static bool ResolveColumn(const TypeInfo& ti, std::string_view name, ComponentColumn& column) {
+      const auto& typer = Typer::Get();
+
+      auto it = std::ranges::find(ti.fields, name, &TypeField::name);
+      if (it == ti.fields.end()) {
+         WARN("Component '{}' doesn't have field '{}'", ti.name, name);
+         return false;
+      }
+
+      const auto& fieldTi = typer.GetTypeInfo(it->typeID);
+
+      BinaryLayout layout;
+      bool bytes = BuildBinaryLayout(fieldTi, 0, layout) && std::ranges::all_of(layout.leaves, [](const BinaryLeaf& leaf) {
+         return leaf.kind == BinaryKind::Raw || leaf.kind == BinaryKind::Entity;
+      });
+      if (!bytes) {
+         WARN("Field '{}' of component '{}' can't be copied to column", name, ti.name);
+         return false;
+      }
+
+      column.name = it->name;
+      column.typeID = it->typeID;
+      column.offset = (uint)it->offset;
+      column.size = (uint)fieldTi.typeSizeOf;
+      return true;
+   }
+
+   bool GatherComponentColumns(const Scene& scene, TypeID typeID, std::span<const std::string_view> fields,
+      ComponentColumns& columns) {
+      const auto& typer = Typer::Get();
+
+      const auto* ci = typer.FindComponent(typeID);
+      if (!ci) {
+         return false;
+      }
+
+      const auto& ti = typer.GetTypeInfo(typeID);
+
+      columns.typeID = typeID;
+      columns.entities.clear();
+      columns.columns.resize(fields.size());
+
+      for (size_t i = 0; i < fields.size(); ++i) {
+         if (!ResolveColumn(ti, fields[i], columns.columns[i])) {
+            return false;
+         }
+      }
+
+      auto view = ci->storageView(scene);
+      uint rows = view.Size();
+
+      if (rows > 0) {
+         columns.entities.assign(view.set->data(), view.set->data() + rows);
+      }
+      for (auto& column : columns.columns) {
+         column.data.resize((size_t)rows * column.size);
+      }
+
+      if (rows > 0) {
+         CopyColumns<true>(view, columns.columns, rows);
+      }
+
+      return true;
+   }
+
+   void ScatterComponentColumns(Scene& scene, const ComponentColumns& columns, bool patch) {
+      const auto& typer = Typer::Get();
+
+      const auto* ci = typer.FindComponent(columns.typeID);
+      ASSERT(ci);
+
+      auto view = ci->storageView(scene);
+      uint rows = columns.Rows();
+
+      // storage is not changed since gather, rows are storage indices
+      bool samePacking = view.Size() == rows
+         && (rows == 0 || std::equal(columns.entities.begin(), columns.entities.end(), view.set->data()));
+
+      if (samePacking) {
+         CopyColumns<false>(view, columns.columns, rows);
+      } else if (view.set) {
+         for (uint row = 0; row < rows; ++row) {
+            entt::entity entity = columns.entities[row];
+            if (!view.set->contains(entity)) {
+               continue;
+            }
+
+            byte* component = view.At((uint)view.set->index(entity));
+            for (const auto& column : columns.columns) {
+               std::memcpy(component + column.offset, column.data.data() + (size_t)row * column.size, column.size);
+            }
+         }
+      }
+
+      if (patch) {
+         ASSERT(JobSystem::Get().IsMainThread());
+
+         for (entt::entity e : columns.entities) {
+            Entity entity{ e, &scene };
+            if (ci->has(entity)) {
+               ci->patch(entity);
+            }
+         }
+      }
+   }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <span>
+
+#include <entt/entt.hpp>
+
+#include "core/Assert.h"
+#include "core/Core.h"
+#include "core/Type.h"
+#include "math/Types.h"
+
+namespace pbe {
+
+   class Scene;
+
+   // values of one field of component, one per row of ComponentColumns
+   struct ComponentColumn {
+      string name;
+      TypeID typeID = InvalidTypeID;
+      uint offset = 0; // in component
+      uint size = 0; // of value
+
+      std::vector<byte> data;
+
+      template<typename T>
+      std::span<T> As() {
+         ASSERT(GetTypeID<T>() == typeID && sizeof(T) == size);
+         return { (T*)data.data(), data.size() / sizeof(T) };
+      }
+
+      template<typename T>
+      std::span<const T> As() const {
+         ASSERT(GetTypeID<T>() == typeID && sizeof(T) == size);
+         return { (const T*)data.data(), data.size() / sizeof(T) };
+      }
+   };
+
+   // Fields of component of all entities as structure of arrays. Fields are picked by name from TypeInfo::fields,
+   // only trivially copyable fields (binary layout without strings) are supported.
+   // Gather doesn't emit registry signals, so it may run on worker thread while storage of component is not changed.
+   // Scatter patches components by default, so it is main thread only
+   struct CORE_API ComponentColumns {
+      TypeID typeID = InvalidTypeID;
+      std::vector<entt::entity> entities; // of rows
+      std::vector<ComponentColumn> columns;
+
+      uint Rows() const { return (uint)entities.size(); }
+
+      // nullptr if field was not gathered
+      ComponentColumn* Find(std::string_view name);
+      const ComponentColumn* Find(std::string_view name) const;
+
+      template<typename T>
+      std::span<T> Column(std::string_view name) {
+         auto* column = Find(name);
+         return column ? column->As<T>() : std::span<T>{};
+      }
+   };
+
+   // false if type is not registered component or some field is missing or can't be copied as bytes
+   CORE_API bool GatherComponentColumns(const Scene& scene, TypeID typeID, std::span<const std::string_view> fields,
+      ComponentColumns& columns);
+
+   template<typename Component>
+   bool GatherComponentColumns(const Scene& scene, std::initializer_list<std::string_view> fields, ComponentColumns& columns) {
+      return GatherComponentColumns(scene, GetTypeID<Component>(), std::span{ fields.begin(), fields.size() }, columns);
+   }
+
+   // write columns back to components of the same entities, rows of entities without component are skipped.
+   // Every row is MarkComponentUpdated, so change versions and scene journal see the write.
+   // patch = false is unsafe: they keep old state. Only for components nobody tracks, e.g. scatter on worker thread
+   // of runtime-only component
+   CORE_API void ScatterComponentColumns(Scene& scene, const ComponentColumns& columns, bool patch = true);
+
+}
@@ -46,7 +46,11 @@ namespace pbe {
    }
 
    const char* Entity::GetName() const {
-      return Get<TagComponent>().tag.c_str();
+      return Get<TagComponent>().tag.CStr();
+   }
+
+   void Entity::SetName(std::string_view name) {
+      scene->registry.emplace_or_replace<TagComponent>(id, StringID{ name });
    }
 
    UUID Entity::GetUUID() const {
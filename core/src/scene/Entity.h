@@ -129,6 +129,7 @@ namespace pbe {
       const SceneTransformComponent& GetTransform() const;
 
       const char* GetName() const;
+      void SetName(std::string_view name);
       UUID GetUUID() const;
 
    private:
@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "NameIndex.h"
+
+#include "Component.h"
+
+
+namespace pbe {
+
+   void NameIndex::Connect(entt::registry& registry) {
+      registry.on_construct<TagComponent>().connect<&NameIndex::Add>(this);
+      registry.on_destroy<TagComponent>().connect<&NameIndex::Remove>(this);
+      registry.on_update<TagComponent>().connect<&NameIndex::Update>(this);
+   }
+
+   void NameIndex::Add(entt::registry& registry, entt::entity entity) {
+      // string view points to interned string
+      auto name = registry.get<TagComponent>(entity).tag.Str();
+      entityToName[entity] = names.emplace(name, entity);
+   }
+
+   void NameIndex::Remove(entt::registry& registry, entt::entity entity) {
+      auto it = entityToName.find(entity);
+      if (it != entityToName.end()) {
+         names.erase(it->second);
+         entityToName.erase(it);
+      }
+   }
+
+   void NameIndex::Update(entt::registry& registry, entt::entity entity) {
+      Remove(registry, entity);
+      Add(registry, entity);
+   }
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+
+#include "core/Core.h"
+
+namespace pbe {
+
+   // entities by TagComponent name, kept up to date by registry signals
+   class CORE_API NameIndex {
+   public:
+      void Connect(entt::registry& registry);
+
+      // first entity with name which satisfies pred(entt::entity) or null
+      template<typename Pred>
+      entt::entity FindIf(std::string_view name, Pred&& pred) const {
+         auto [it, end] = names.equal_range(name);
+         for (; it != end; ++it) {
+            if (pred(it->second)) {
+               return it->second;
+            }
+         }
+         return entt::null;
+      }
+
+      // func(std::string_view name, entt::entity entity) for names starting with prefix, in name order
+      template<typename Func>
+      void ForEachWithPrefix(std::string_view prefix, Func&& func) const {
+         for (auto it = names.lower_bound(prefix); it != names.end() && it->first.starts_with(prefix); ++it) {
+            func(it->first, it->second);
+         }
+      }
+
+   private:
+      using Names = std::multimap<std::string_view, entt::entity, std::less<>>;
+
+      Names names;
+      std::unordered_map<entt::entity, Names::iterator> entityToName;
+
+      void Add(entt::registry& registry, entt::entity entity);
+      void Remove(entt::registry& registry, entt::entity entity);
+      void Update(entt::registry& registry, entt::entity entity);
+   };
+
+}
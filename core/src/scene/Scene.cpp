@@ -1,20 +1,50 @@
 #include "pch.h"
 #include "Scene.h"
 
+#include <charconv>
+
 #include "Component.h"
 #include "Entity.h"
+#include "SharedComponent.h"
+#include "typer/Registration.h"
 #include "typer/Typer.h"
 #include "fs/FileSystem.h"
 #include "rend/DbgRend.h"
 #include "script/Script.h"
 #include "typer/Serialize.h"
 #include "physics/PhysicsScene.h"
+#include "core/CVar.h"
+#include "core/JobSystem.h"
+#include "core/Profiler.h"
 
 namespace pbe {
 
+   struct Scene::ChangeVersionsListener : ComponentListener {
+      Scene& scene;
+
+      ChangeVersionsListener(Scene& scene) : scene(scene) {}
+
+      void OnComponentEvent(entt::entity entity, TypeID typeID, ComponentEvent event) override {
+         scene.MarkChanged(typeID, entity);
+      }
+   };
+
    Scene::Scene(bool withRoot) {
       dbgRend = std::make_unique<DbgRend>();
 
+      nameIndex.Connect(registry);
+
+      changeVersions[GetTypeID<SceneTransformComponent>()];
+      changeVersions[GetTypeID<TagComponent>()];
+      transformVersions = &changeVersions[GetTypeID<SceneTransformComponent>()];
+
+      for (const auto& ci : Typer::Get().components) {
+         changeVersions[ci.typeID];
+      }
+
+      changeVersionsListener = std::make_unique<ChangeVersionsListener>(*this);
+      ConnectComponentListener(*changeVersionsListener);
+
       if (withRoot) {
          SetRootEntity(CreateWithUUID(UUID{}, Entity{}, "Scene"));
       }
@@ -41,23 +71,96 @@ namespace pbe {
       auto entity = Entity{ entityID, this };
       entity.Add<UUIDComponent>(uuid);
       if (!name.empty()) {
-         entity.Add<TagComponent>(name.data());
+         entity.Add<TagComponent>(StringID{ name });
       } else {
          // todo: support entity without name
-         entity.Add<TagComponent>(std::format("{} {}", "Entity", EntitiesCount()));
+         entity.Add<TagComponent>(StringID{ std::format("{} {}", "Entity", EntitiesCount()) });
       }
 
       entity.Add<SceneTransformComponent>(entity, parent);
 
-      ASSERT(uuidToEntities.find(uuid) == uuidToEntities.end());
+      ASSERT(!uuidToEntities.Contains(uuid));
       uuidToEntities[uuid] = entityID;
 
       return entity;
    }
 
+   std::vector<Entity> Scene::CreateBatch(int count, const Entity& parent, const Entity& prototype) {
+      std::vector<entt::entity> ids(count);
+      registry.create(ids.begin(), ids.end());
+
+      // created disabled, so construct callbacks don't touch systems until all components are added
+      registry.insert<DisableMarker>(ids.begin(), ids.end());
+
+      std::vector<UUIDComponent> uuids(count); // random uuids
+      registry.insert<UUIDComponent>(ids.begin(), ids.end(), uuids.begin());
+
+      uuidToEntities.Reserve(uuidToEntities.Size() + count);
+      for (int i = 0; i < count; ++i) {
+         uuidToEntities[uuids[i].uuid] = ids[i];
+      }
+
+      TagComponent tag{ StringID{ prototype ? prototype.GetName() : "Entity" } };
+      registry.insert<TagComponent>(ids.begin(), ids.end(), tag);
+
+      // local transform is kept on parenting, so each entity is linked and marked dirty once
+      SceneTransformComponent trans;
+      if (prototype) {
+         const auto& protoTrans = prototype.GetTransform();
+         trans.SetLocalTransform(protoTrans.LocalPosition(), protoTrans.LocalRotation(), protoTrans.LocalScale());
+      }
+      registry.insert<SceneTransformComponent>(ids.begin(), ids.end(), trans);
+
+      Entity parentEntity = parent ? parent : GetRootEntity();
+      for (auto id : ids) {
+         auto& idTrans = registry.get<SceneTransformComponent>(id);
+         idTrans.entity = Entity{ id, this };
+         idTrans.SetParent(parentEntity, -1, true);
+      }
+
+      if (prototype) {
+         for (const auto& ci : Typer::Get().components) {
+            if (auto* pSrc = ci.tryGetConst(prototype)) {
+               ci.copyCtorBatch(*this, ids, pSrc);
+            }
+         }
+      }
+
+      for (auto& system : systems) {
+         system->OnEntityEnable(ids);
+      }
+      registry.erase<DisableMarker>(ids.begin(), ids.end());
+
+      std::vector<Entity> entities;
+      entities.reserve(count);
+      for (auto id : ids) {
+         entities.emplace_back(id, this);
+      }
+
+      return entities;
+   }
+
    Entity Scene::GetEntity(UUID uuid) {
-      auto it = uuidToEntities.find(uuid);
-      return it == uuidToEntities.end() ? Entity{} : Entity{ uuidToEntities[(uint64)uuid], this };
+      auto* entityID = uuidToEntities.Find(uuid);
+      return entityID ? Entity{ *entityID, this } : Entity{};
+   }
+
+   void Scene::GetEntities(std::span<const UUID> uuids, std::span<Entity> entities) {
+      ASSERT(uuids.size() == entities.size());
+
+      std::vector<entt::entity*> entityIDs(uuids.size());
+      uuidToEntities.FindBatch(uuids, entityIDs);
+
+      for (size_t i = 0; i < uuids.size(); ++i) {
+         entities[i] = entityIDs[i] ? Entity{ *entityIDs[i], this } : Entity{};
+      }
+   }
+
+   void Scene::ReserveEntities(int nEntities) {
+      uuidToEntities.Reserve(nEntities);
+      registry.storage<UUIDComponent>().reserve(nEntities);
+      registry.storage<TagComponent>().reserve(nEntities);
+      registry.storage<SceneTransformComponent>().reserve(nEntities);
    }
 
    Entity Scene::GetRootEntity() {
@@ -80,16 +183,29 @@ namespace pbe {
          iter--;
       }
 
-      int idx = iter + 1 != nameLen ? atoi(name + iter + 1) : 0;
       string_view namePrefix = string_view(name, iter + 1);
-      //
+
+      // next number after max among "<prefix> <number>" names
+      int idx = 0;
+      nameIndex.ForEachWithPrefix(namePrefix, [&](string_view otherName, entt::entity) {
+         auto suffix = otherName.substr(namePrefix.size());
+         if (suffix.size() < 2 || suffix[0] != ' ') {
+            return;
+         }
+
+         int otherIdx = 0;
+         auto [end, ec] = std::from_chars(suffix.data() + 1, suffix.data() + suffix.size(), otherIdx);
+         if (ec == std::errc{} && end == suffix.data() + suffix.size()) {
+            idx = std::max(idx, otherIdx);
+         }
+      });
 
       Entity duplicatedEntity = Create(std::format("{} {}", namePrefix, ++idx));
 
       auto& trans = entity.GetTransform();
       duplicatedEntity.GetTransform().SetParent(trans.parent, trans.GetChildIdx() + 1);
 
-      std::unordered_map<UUID, DuplicateContext> hierEntitiesMap;
+      UUIDMap<DuplicateContext> hierEntitiesMap;
       DuplicateHierEntitiesWithMap(duplicatedEntity, entity, false, hierEntitiesMap);
 
       Duplicate(duplicatedEntity, entity, false, hierEntitiesMap);
@@ -104,53 +220,64 @@ namespace pbe {
       return !entity.HasAny<DisableMarker, DelayedDisableMarker, DelayedEnableMarker>();
    }
 
-   void Scene::EntityEnable(Entity& entity, bool withChilds) {
-      if (entity.Has<DelayedEnableMarker>()) {
-         return;
-      }
-      if (entity.Has<DelayedDisableMarker>()) {
-         entity.Remove<DelayedDisableMarker>();
+   // entity and its descendants in pre-order, without recursion. func returns false to skip children of entity
+   template<typename Func>
+   static void ForEachInSubtree(const Entity& entity, bool withChilds, Func&& func) {
+      if (!func(entity) || !withChilds) {
          return;
       }
-      if (!entity.Has<DisableMarker>()) {
-         return;
+
+      Entity child = entity.GetTransform().NextInHierarchy(entity);
+      while (child) {
+         bool descend = func(child);
+         child = child.GetTransform().NextInHierarchy(entity, !descend);
       }
+   }
 
-      if (withChilds) {
-         for (auto& child : entity.GetTransform().children) {
-            EntityEnable(child);
+   // state of entity is not changed - its subtree is not visited, so explicitly disabled children stay disabled
+   void Scene::EntityEnable(Entity& entity, bool withChilds) {
+      std::vector<entt::entity> enabled;
+
+      ForEachInSubtree(entity, withChilds, [&](const Entity& e) {
+         if (e.Has<DelayedEnableMarker>()) {
+            return false;
          }
-      }
+         if (e.Has<DelayedDisableMarker>()) {
+            registry.erase<DelayedDisableMarker>(e.GetID());
+            return false;
+         }
+         if (!e.Has<DisableMarker>()) {
+            return false;
+         }
+         enabled.emplace_back(e.GetID());
+         return true;
+      });
 
-      entity.Add<DelayedEnableMarker>();
-      ASSERT(entity.Has<DisableMarker>() && !entity.Has<DelayedDisableMarker>());
+      registry.insert<DelayedEnableMarker>(enabled.begin(), enabled.end());
    }
 
    // todo: when add child to disabled entity, it must be disabled too
    void Scene::EntityDisable(Entity& entity, bool withChilds) {
-      if (entity.HasAny<DisableMarker, DelayedDisableMarker>()) {
-         return;
-      }
-      if (entity.Has<DelayedEnableMarker>()) {
-         entity.Remove<DelayedEnableMarker>();
-         return;
-      }
+      std::vector<entt::entity> disabled;
 
-      if (withChilds) {
-         for (auto& child : entity.GetTransform().children) {
-            EntityDisable(child);
+      ForEachInSubtree(entity, withChilds, [&](const Entity& e) {
+         // pending enable of disabled entity is cancelled
+         if (e.Has<DelayedEnableMarker>()) {
+            registry.erase<DelayedEnableMarker>(e.GetID());
+            return false;
          }
-      }
+         if (e.HasAny<DisableMarker, DelayedDisableMarker>()) {
+            return false;
+         }
+         disabled.emplace_back(e.GetID());
+         return true;
+      });
 
-      entity.Add<DelayedDisableMarker>();
-      ASSERT(!(entity.HasAny<DisableMarker, DelayedEnableMarker>()));
+      registry.insert<DelayedDisableMarker>(disabled.begin(), disabled.end());
    }
 
    void Scene::ProcessDelayedEnable() {
-      // disable
-      for (auto& system : systems) {
-         system->OnEntityDisable();
-      }
+      // delayed marker storages are queues of changed entities, nothing to do if they are empty
 
       // todo: iterate over all systems or only scripts
       // const auto& typer = Typer::Get();
@@ -158,25 +285,29 @@ namespace pbe {
       //    si.sceneApplyFunc(*this, [](Script& script) { script.OnDisable(); });
       // }
 
-      for (auto e : ViewAll<DelayedDisableMarker>()) {
-         registry.emplace<DisableMarker>(e);
-      }
-      registry.clear<DelayedDisableMarker>();
+      // disable
+      auto& delayedDisable = registry.storage<DelayedDisableMarker>();
+      if (!delayedDisable.empty()) {
+         std::span<const entt::entity> entities{ delayedDisable.data(), delayedDisable.size() };
+         for (auto& system : systems) {
+            system->OnEntityDisable(entities);
+         }
 
-      // enable
-      for (auto& system : systems) {
-         system->OnEntityEnable();
+         registry.insert<DisableMarker>(delayedDisable.begin(), delayedDisable.end());
+         registry.clear<DelayedDisableMarker>();
       }
 
-      // todo: iterate over all systems or only scripts
-      // for (const auto& si : typer.scripts) {
-      //    si.sceneApplyFunc(*this, [](Script& script) { script.OnEnable(); });
-      // }
+      // enable
+      auto& delayedEnable = registry.storage<DelayedEnableMarker>();
+      if (!delayedEnable.empty()) {
+         std::span<const entt::entity> entities{ delayedEnable.data(), delayedEnable.size() };
+         for (auto& system : systems) {
+            system->OnEntityEnable(entities);
+         }
 
-      for (auto e : ViewAll<DelayedEnableMarker>()) {
-         registry.erase<DisableMarker>(e);
+         registry.erase<DisableMarker>(delayedEnable.begin(), delayedEnable.end());
+         registry.clear<DelayedEnableMarker>();
       }
-      registry.clear<DelayedEnableMarker>();
    }
 
    struct DelayedDestroyMarker {
@@ -188,23 +319,29 @@ namespace pbe {
    }
 
    void Scene::DestroyImmediate(Entity entity, bool withChilds) {
-      auto& trans = entity.GetTransform();
+      std::vector<entt::entity> subtree;
 
-      // todo: mb use iterator on children?
-      for (int iChild = (int)trans.children.size() - 1; iChild >= 0; --iChild) {
-         auto& child = trans.children[iChild];
-         if (withChilds) {
-            DestroyImmediate(child, true);
-         } else {
-            child.GetTransform().SetParent(trans.parent);
+      if (withChilds) {
+         // whole subtree is destroyed, so children are not unlinked one by one
+         const auto& trans = entity.GetTransform();
+         for (Entity child = trans.NextInHierarchy(entity); child; child = child.GetTransform().NextInHierarchy(entity)) {
+            subtree.emplace_back(child.GetID());
+         }
+      } else {
+         while (Entity child = entity.GetTransform().FirstChild()) {
+            child.GetTransform().SetParent(entity.GetTransform().parent);
          }
+      }
+
+      entity.GetTransform().SetParentInternal();
 
-         // todo: scene component may be shrink during child destroy
-         trans = entity.GetTransform();
+      // children are destroyed before their parents
+      for (auto it = subtree.rbegin(); it != subtree.rend(); ++it) {
+         uuidToEntities.Erase(registry.get<UUIDComponent>(*it).uuid);
+         registry.destroy(*it);
       }
-      trans.SetParentInternal();
 
-      uuidToEntities.erase(entity.GetUUID());
+      uuidToEntities.Erase(entity.GetUUID());
       registry.destroy(entity.GetID());
    }
 
@@ -223,15 +360,31 @@ namespace pbe {
    void Scene::OnTick() {
       OnSync();
 
+      UpdateWorldTransforms();
+
       // sync phys scene with changed transforms outside physics
       GetPhysics()->SyncPhysicsWithScene();
-      ClearComponent<TransformChangedMarker>();
 
       for (auto [entityID, trans] : View<SceneTransformComponent>().each()) {
          trans.UpdatePrevTransform();
       }
    }
 
+   void Scene::UpdateWorldTransforms() {
+      UpdateWorldTransformsSince(worldVersion);
+      worldVersion = NextChangeVersion();
+   }
+
+   void Scene::UpdateWorldTransformsSince(uint version) {
+      // every transform that becomes dirty is versioned, its dirty parents are updated first by UpdateWorld
+      transformVersions->ForEachChangedSince(version, [&](entt::entity e) {
+         const auto* trans = registry.valid(e) ? registry.try_get<SceneTransformComponent>(e) : nullptr;
+         if (trans && trans->IsWorldDirty()) {
+            trans->UpdateWorld();
+         }
+      });
+   }
+
    void Scene::OnStart() {
       const auto& typer = Typer::Get();
 
@@ -241,15 +394,37 @@ namespace pbe {
    }
 
    void Scene::OnUpdate(float dt) {
+      // systems read world transforms without lazy update, so it must be up to date before them
+      UpdateWorldTransforms();
+
+      // rebuild every frame: scripts may be reloaded, graph of few nodes is cheap
+      systemScheduler.Clear();
+
+      // world cache is updated after every node that may write transforms. Update node writes transforms,
+      // so it waits for the writer and next readers wait for it
+      auto addNode = [&](std::string_view name, const SystemAccess& access, std::function<void(float)> update) {
+         systemScheduler.Add(name, access, std::move(update));
+
+         if (access.Writes(GetTypeID<SceneTransformComponent>())) {
+            systemScheduler.Add("UpdateWorldTransforms", SystemAccess{}.Write<SceneTransformComponent>(), [this](float dt) {
+               UpdateWorldTransformsSince(worldVersion);
+            });
+         }
+      };
+
       for (auto& system : systems) {
-         system->OnUpdate(dt);
+         addNode(system->GetName(), system->GetAccess(), [&system](float dt) { system->OnUpdate(dt); });
       }
 
       const auto& typer = Typer::Get();
 
       for (const auto& si : typer.scripts) {
-         si.sceneApplyFunc(*this, [dt](Script& script) { script.OnUpdate(dt); });
+         addNode(typer.GetTypeInfo(si.typeID).name, si.access, [this, &si](float dt) {
+            si.sceneUpdateFunc(*this, dt);
+         });
       }
+
+      systemScheduler.Update(registry, dt);
    }
 
    void Scene::OnStop() {
@@ -267,40 +442,143 @@ namespace pbe {
    }
 
    Entity Scene::FindByName(std::string_view name) {
-      for (auto [e, tag] : View<TagComponent>().each()) {
-         if (tag.tag == name) {
-            return Entity{e, this};
-         }
-      }
-      return {};
+      auto e = nameIndex.FindIf(name, [&](entt::entity e) { return !registry.all_of<DisableMarker>(e); });
+      return e != entt::null ? Entity{ e, this } : Entity{};
+   }
+
+   std::vector<Entity> Scene::FindByNamePrefix(std::string_view prefix) {
+      std::vector<Entity> entities;
+      nameIndex.ForEachWithPrefix(prefix, [&](std::string_view, entt::entity e) {
+         entities.emplace_back(e, this);
+      });
+      return entities;
    }
 
    uint Scene::EntitiesCount() const {
-      return (uint)uuidToEntities.size();
+      return uuidToEntities.Size();
+   }
+
+   void Scene::ConnectComponentListener(ComponentListener& listener, bool connect) {
+      pbe::ConnectComponentListener<UUIDComponent>(registry, listener, connect);
+      pbe::ConnectComponentListener<TagComponent>(registry, listener, connect);
+      pbe::ConnectComponentListener<SceneTransformComponent>(registry, listener, connect);
+
+      for (const auto& ci : Typer::Get().components) {
+         ci.connectListener(registry, listener, connect);
+      }
+   }
+
+   void Scene::MarkChanged(TypeID typeID, entt::entity entity) {
+      if (auto* versions = GetChangeVersions(typeID)) {
+         versions->Mark(entity, changeVersion);
+      }
+   }
+
+   const ChangeVersions* Scene::GetChangeVersions(TypeID typeID) const {
+      auto it = changeVersions.find(typeID);
+      return it != changeVersions.end() ? &it->second : nullptr;
+   }
+
+   ChangeVersions* Scene::GetChangeVersions(TypeID typeID) {
+      auto it = changeVersions.find(typeID);
+      return it != changeVersions.end() ? &it->second : nullptr;
    }
 
    Own<Scene> Scene::Copy() const {
       auto pScene = std::make_unique<Scene>(false);
+      auto& dstRegistry = pScene->registry;
+
+      const auto& srcUUIDs = *TryStorage<UUIDComponent>();
+      std::span<const entt::entity> srcIds{ srcUUIDs.data(), srcUUIDs.size() };
 
-      Entity srcRoot{ rootEntityId, const_cast<Scene*>(this) };
-      Entity dstRoot = pScene->CreateWithUUID(srcRoot.GetUUID(), Entity{}, srcRoot.GetName());
-      pScene->SetRootEntity(dstRoot);
+      std::vector<entt::entity> dstIds(srcIds.size());
+      dstRegistry.create(dstIds.begin(), dstIds.end());
 
-      std::unordered_map<UUID, DuplicateContext> hierEntitiesMap;
-      pScene->DuplicateHierEntitiesWithMap(dstRoot, srcRoot, true, hierEntitiesMap);
+      // src entity index -> dst entity
+      uint maxIdx = 0;
+      for (auto e : srcIds) {
+         maxIdx = std::max(maxIdx, (uint)entt::to_entity(e));
+      }
+      std::vector<entt::entity> remap(srcIds.empty() ? 0 : maxIdx + 1, (entt::entity)entt::null);
+      for (size_t i = 0; i < srcIds.size(); ++i) {
+         remap[entt::to_entity(srcIds[i])] = dstIds[i];
+      }
 
-      pScene->Duplicate(dstRoot, srcRoot, true, hierEntitiesMap);
+      // while copy entities, they are disabled, systems get all of them in one OnEntityEnable
+      dstRegistry.insert<DisableMarker>(dstIds.begin(), dstIds.end());
 
-      pScene->DuplicateEntityEnable(dstRoot, hierEntitiesMap);
-      pScene->ProcessDelayedEnable();
+      // construct signals would disable page copy of storages, versions are marked in bulk after copy
+      pScene->ConnectComponentListener(*pScene->changeVersionsListener, false);
 
-      return pScene;
-   }
+      CopyComponentStorage<UUIDComponent>(srcUUIDs, dstRegistry.storage<UUIDComponent>(), remap);
+      CopyComponentStorage<TagComponent>(*TryStorage<TagComponent>(), dstRegistry.storage<TagComponent>(), remap);
+      CopyComponentStorage<SceneTransformComponent>(*TryStorage<SceneTransformComponent>(), dstRegistry.storage<SceneTransformComponent>(), remap);
+
+      pScene->ReserveEntities((int)dstIds.size());
+      for (auto [e, uuid] : dstRegistry.storage<UUIDComponent>().each()) {
+         pScene->uuidToEntities[uuid.uuid] = e;
+      }
+
+      for (auto [_, trans] : dstRegistry.storage<SceneTransformComponent>().each()) {
+         trans.RemapEntities(remap, pScene.get());
+      }
+
+      const auto& typer = Typer::Get();
+
+      for (const auto& ci : typer.components) {
+         ci.copyStorage(*this, *pScene, remap);
+
+         const auto& ti = typer.GetTypeInfo(ci.typeID);
+         if (!ti.hasEntityRef) {
+            continue;
+         }
+
+         for (auto e : dstIds) {
+            Entity dst{ e, pScene.get() };
+            auto* pDst = ci.tryGet(dst);
+            if (!pDst) {
+               continue;
+            }
 
-   static Scene* gCurrentDeserializedScene = nullptr;
+            for (const auto& field : ti.fields) {
+               auto& filedTypeInfo = typer.GetTypeInfo(field.typeID);
+               if (!filedTypeInfo.hasEntityRef) {
+                  continue;
+               }
+
+               // todo: while dont support nested entity ref
+               ASSERT(filedTypeInfo.IsSimpleType());
 
-   Scene* Scene::GetCurrentDeserializedScene() {
-      return gCurrentDeserializedScene;
+               // it still references src scene, because it was copied by value
+               auto pDstEntity = (Entity*)((byte*)pDst + field.offset);
+               if (*pDstEntity && pDstEntity->GetScene() == this) {
+                  *pDstEntity = Entity{ remap[entt::to_entity(pDstEntity->GetID())], pScene.get() };
+               }
+            }
+         }
+      }
+
+      pScene->ConnectComponentListener(*pScene->changeVersionsListener);
+      for (auto [id, storage] : dstRegistry.storage()) {
+         if (auto* versions = pScene->GetChangeVersions((TypeID)id)) {
+            versions->MarkAll({ storage.data(), storage.size() }, pScene->changeVersion);
+         }
+      }
+
+      if (rootEntityId != entt::null) {
+         pScene->rootEntityId = remap[entt::to_entity(rootEntityId)];
+      }
+
+      std::vector<entt::entity> enabled;
+      for (size_t i = 0; i < srcIds.size(); ++i) {
+         if (!registry.any_of<DisableMarker, DelayedDisableMarker, DelayedEnableMarker>(srcIds[i])) {
+            enabled.emplace_back(dstIds[i]);
+         }
+      }
+      dstRegistry.insert<DelayedEnableMarker>(enabled.begin(), enabled.end());
+      pScene->ProcessDelayedEnable();
+
+      return pScene;
    }
 
    void Scene::EntityDisableImmediate(Entity& entity) {
@@ -308,20 +586,20 @@ namespace pbe {
       entity.Add<DisableMarker>();
    }
 
-   void Scene::DuplicateHierEntitiesWithMap(Entity& dst, const Entity& src, bool copyUUID, std::unordered_map<UUID, DuplicateContext>& hierEntitiesMap) {
+   void Scene::DuplicateHierEntitiesWithMap(Entity& dst, const Entity& src, bool copyUUID, UUIDMap<DuplicateContext>& hierEntitiesMap) {
       hierEntitiesMap[src.GetUUID()] = DuplicateContext{ dst.GetID(), src.Enabled() };
       // while duplicate entities, disable them
       dst.GetScene()->EntityDisableImmediate(dst);
 
       auto& srcTrans = src.GetTransform();
 
-      for (auto child : srcTrans.children) {
+      for (auto child : srcTrans.Children()) {
          Entity duplicatedChild = CreateWithUUID(copyUUID ? child.GetUUID() : UUID{}, dst, child.GetName());
          DuplicateHierEntitiesWithMap(duplicatedChild, child, copyUUID, hierEntitiesMap);
       }
    }
 
-   void Scene::Duplicate(Entity& dst, const Entity& src, bool copyUUID, std::unordered_map<UUID, DuplicateContext>& hierEntitiesMap) {
+   void Scene::Duplicate(Entity& dst, const Entity& src, bool copyUUID, UUIDMap<DuplicateContext>& hierEntitiesMap) {
       // if copyUUID == true, dst must be in another scene
       ASSERT(!copyUUID || dst.GetScene() != src.GetScene());
 
@@ -329,29 +607,25 @@ namespace pbe {
 
       // todo: move after loop?
       auto& dstTrans = dst.GetTransform();
-      dstTrans.position = srcTrans.position;
-      dstTrans.rotation = srcTrans.rotation;
-      dstTrans.scale = srcTrans.scale;
+      dstTrans.SetLocalPosition(srcTrans.LocalPosition());
+      dstTrans.SetLocalRotation(srcTrans.LocalRotation());
+      dstTrans.SetLocalScale(srcTrans.LocalScale());
 
-      for (auto child : srcTrans.children) {
+      for (auto child : srcTrans.Children()) {
          Entity duplicatedChild = { hierEntitiesMap[child.GetUUID()].enttEntity, dst.GetScene()};
          Duplicate(duplicatedChild, child, copyUUID, hierEntitiesMap);
       }
 
       const auto& typer = Typer::Get();
 
-      // todo: use entt for iterate components
-      for (const auto& ci : typer.components) {
+      // only components of src, not all registered
+      typer.ForEachComponent(typer.GetComponentMask(src), [&](const ComponentInfo& ci) {
          auto* pSrc = ci.tryGetConst(src);
-         if (!pSrc) {
-            continue;
-         }
-
          auto pDst = ci.copyCtor(dst, pSrc);
 
          const auto& ti = typer.GetTypeInfo(ci.typeID);
          if (!ti.hasEntityRef) {
-            continue;
+            return;
          }
 
          for (const auto& field : ti.fields) {
@@ -369,28 +643,27 @@ namespace pbe {
 
                auto uuid = pDstEntity->GetUUID();
                
-               auto it = hierEntitiesMap.find(uuid);
-               if (it != hierEntitiesMap.end()) {
-                  *pDstEntity = Entity{ it->second.enttEntity, dst.GetScene()};
+               if (auto* context = hierEntitiesMap.Find(uuid)) {
+                  *pDstEntity = Entity{ context->enttEntity, dst.GetScene()};
                }
             }
          }
-      }
+      });
    }
 
-   void Scene::DuplicateEntityEnable(Entity& root, std::unordered_map<UUID, DuplicateContext>& hierEntitiesMap) {
+   void Scene::DuplicateEntityEnable(Entity& root, UUIDMap<DuplicateContext>& hierEntitiesMap) {
       ASSERT(root.GetScene() == this);
       // todo: mb create set with enabled entities?
       // todo: not fastest solution, find better way to implement copy scene, duplicate logic
 
-      for (auto [_, context] : hierEntitiesMap) {
+      hierEntitiesMap.ForEach([&](UUID, DuplicateContext& context) {
          Entity entity{ context.enttEntity, this };
          if (context.enabled) {
             EntityEnable(entity, false);
          } else {
             EntityDisable(entity, false);
          }
-      }
+      });
    }
 
    static string gAssetsPath = "../../assets/";
@@ -399,39 +672,242 @@ namespace pbe {
       return gAssetsPath + path.data();
    }
 
+   CVarValue<bool> cvBinarySceneCache{ "scene/binary cache", true };
+
+   CVarValue<bool> cvParallelSceneLoad{ "scene/parallel load", true };
+
+   static string GetBinaryScenePath(string_view path) {
+      return fs::path{ path }.replace_extension(".scnb").string();
+   }
+
+   // 'shared' section of scene file. Payloads of shared components are stored once, entities reference them by index.
+   // Tables live only while file is written or read
+   struct SceneSharedSection {
+      struct Component {
+         Own<SharedPayloadTable> table;
+         std::vector<SharedHandle> entityHandles; // by entity index, for serialize. Handle is file index
+         std::vector<SharedHandle> handles; // by file index, for deserialize
+      };
+
+      std::vector<Component> components; // by component idx
+   };
+
+   static void SharedSectionSerialize(Serializer& ser, const Scene& scene, SceneSharedSection& section) {
+      const auto& typer = Typer::Get();
+      section.components.resize(typer.components.size());
+
+      // dedup current values, so file never has stale payload
+      bool empty = true;
+      for (const auto& ci : typer.components) {
+         if (!ci.createPayloadTable) {
+            continue;
+         }
+
+         auto view = ci.storageView(scene);
+         if (view.Size() == 0) {
+            continue;
+         }
+
+         auto& component = section.components[ci.idx];
+         component.table = ci.createPayloadTable();
+
+         const auto* entities = view.set->data();
+         for (uint i = 0; i < view.Size(); ++i) {
+            auto entityIdx = (size_t)entt::to_entity(entities[i]);
+            if (entityIdx >= component.entityHandles.size()) {
+               component.entityHandles.resize(std::max(entityIdx + 1, component.entityHandles.size() * 2), InvalidSharedHandle);
+            }
+            component.entityHandles[entityIdx] = component.table->Add(view.At(i));
+         }
+         empty = false;
+      }
+
+      if (empty) {
+         return;
+      }
+
+      ser.Key("shared");
+      SERIALIZER_MAP(ser);
+
+      for (const auto& component : section.components) {
+         const auto* table = component.table.get();
+         if (!table) {
+            continue;
+         }
+
+         TypeID typeID = table->GetTypeID();
+
+         ser.Key(typer.GetTypeInfo(typeID).name);
+         SERIALIZER_SEQ(ser);
+
+         for (SharedHandle handle = 0; handle < table->PayloadsCount(); ++handle) {
+            ser.Ser({}, typeID, table->GetPayload(handle));
+         }
+      }
+   }
+
+   static void SharedSectionDeserialize(const Deserializer& deser, SceneSharedSection& section) {
+      const auto& typer = Typer::Get();
+      section.components.resize(typer.components.size());
+
+      if (!deser) {
+         return;
+      }
+
+      for (TextNode node : deser.node) {
+         int idx = typer.FindComponentIdx(node.Key());
+         const auto* ci = idx >= 0 ? &typer.components[idx] : nullptr;
+         if (!ci || !ci->createPayloadTable) {
+            WARN("Component '{}' is not shared", node.Key());
+            continue;
+         }
+
+         auto& component = section.components[idx];
+         component.table = ci->createPayloadTable();
+         component.handles.reserve(node.size());
+
+         // each payload is decoded once, not per entity
+         for (TextNode payload : node) {
+            component.handles.emplace_back(component.table->Add([&](byte* value) {
+               typer.Deserialize(deser.Child(payload), {}, ci->typeID, value);
+            }));
+         }
+      }
+   }
+
+   // value is index in shared section or component itself
+   static void ComponentDeserialize(const Deserializer& deser, int idx, byte* value, const SceneSharedSection* shared) {
+      const auto& typer = Typer::Get();
+      const auto& ci = typer.components[idx];
+
+      const TextNode& node = deser.node;
+      if (shared && node.IsScalar()) {
+         const auto& component = shared->components[idx];
+         uint fileIdx;
+         if (component.table && node.TryAs(fileIdx) && fileIdx < component.handles.size()) {
+            ci.duplicate(value, component.table->GetPayload(component.handles[fileIdx]));
+            return;
+         }
+      }
+
+      typer.Deserialize(deser, {}, ci.typeID, value);
+   }
+
+   static void EntitySerialize(Serializer& ser, const Entity& entity, const SceneSharedSection* shared);
+   static void EntityDeserialize(const Deserializer& deser, Scene& scene, const SceneSharedSection* shared);
+
    void SceneSerialize(std::string_view path, Scene& scene) {
-      Serializer ser;
+      // todo:
+      // GetAssetsPath(path)
+      Serializer ser{ path };
 
       {
          SERIALIZER_MAP(ser);
          {
             // ser.KeyValue("sceneName", "test_scene");
 
+            SchemaTable::Serialize(ser);
+
+            SceneSharedSection shared;
+            SharedSectionSerialize(ser, scene, shared);
+
             ser.Key("entities");
             SERIALIZER_SEQ(ser);
             {
-               std::vector<uint64> entitiesUuids;
+               std::vector<UUID> entitiesUuids;
+               entitiesUuids.reserve(scene.EntitiesCount());
 
                for (auto [_, uuid] : scene.ViewAll<UUIDComponent>().each()) {
-                  entitiesUuids.emplace_back((uint64)uuid.uuid);
+                  entitiesUuids.emplace_back(uuid.uuid);
                }
 
-               std::ranges::sort(entitiesUuids);
+               std::ranges::sort(entitiesUuids, {}, [](UUID uuid) { return (uint64)uuid; });
+
+               std::vector<Entity> entities(entitiesUuids.size());
+               scene.GetEntities(entitiesUuids, entities);
 
-               for (auto uuid : entitiesUuids) {
-                  Entity entity = scene.GetEntity(uuid);
-                  EntitySerialize(ser, entity);
+               for (auto& entity : entities) {
+                  EntitySerialize(ser, entity, &shared);
                }
             }
          }
       }
 
-      // todo:
-      // GetAssetsPath(path)
-      ser.SaveToFile(path);
+      if (!ser.Flush()) {
+         WARN("Cant write scene to '{}'", path);
+      }
+
+      auto binaryPath = GetBinaryScenePath(path);
+      if (!cvBinarySceneCache || !SceneSerializeBinary(binaryPath, scene)) {
+         std::error_code ec;
+         fs::remove(binaryPath, ec);
+      }
+   }
+
+   // Components are decoded on workers into staging storages, entity refs are resolved by already filled uuid map.
+   // Then storages are committed to registry and hierarchy is built on main thread
+   static void EntitiesDeserializeParallel(std::span<const TextNode> nodes, std::span<Entity> entities, Scene& scene,
+      const SceneSharedSection& shared, const Deserializer& deser) {
+      constexpr int GRAIN_SIZE = 256;
+
+      const auto& typer = Typer::Get();
+      const int nEntities = (int)nodes.size();
+      const int nChunks = (nEntities + GRAIN_SIZE - 1) / GRAIN_SIZE;
+
+      // per chunk, per component
+      std::vector<std::vector<Own<ComponentStaging>>> chunksStaging(nChunks);
+
+      JobSystem::Get().ParallelForRange(0, nEntities, GRAIN_SIZE, [&](int begin, int end) {
+         OPTICK_EVENT("Deserialize Components");
+
+         auto& staging = chunksStaging[begin / GRAIN_SIZE];
+         staging.resize(typer.components.size());
+
+         for (int i = begin; i < end; ++i) {
+            for (TextNode node : nodes[i]) {
+               int idx = typer.FindComponentIdx(node.Key());
+               if (idx < 0) {
+                  continue;
+               }
+
+               const auto& ci = typer.components[idx];
+               if (!staging[idx]) {
+                  staging[idx] = ci.createStaging();
+               }
+
+               byte* ptr = staging[idx]->Add(entities[i].GetID());
+               ComponentDeserialize(deser.Child(node), idx, ptr, &shared);
+            }
+         }
+      });
+
+      for (int i = 0; i < nEntities; ++i) {
+         deser.Child(nodes[i]).Deser("SceneTransformComponent", entities[i].GetTransform());
+      }
+
+      // chunks order keeps entities order in storages
+      for (int idx = 0; idx < (int)typer.components.size(); ++idx) {
+         for (auto& staging : chunksStaging) {
+            if (idx < staging.size() && staging[idx]) {
+               staging[idx]->Commit(scene);
+            }
+         }
+      }
+
+      for (int i = 0; i < nEntities; ++i) {
+         if (!nodes[i]["disabled"]) {
+            scene.EntityEnable(entities[i], false);
+         }
+      }
    }
 
-   Own<Scene> SceneDeserialize(std::string_view path) {
+   Own<Scene> SceneDeserialize(std::string_view path, std::atomic<float>* progress) {
+      auto setProgress = [&](float value) {
+         if (progress) {
+            progress->store(value, std::memory_order_relaxed);
+         }
+      };
+
       INFO("Deserialize scene '{}'", path);
 
       if (!fs::exists(path)) {
@@ -439,22 +915,42 @@ namespace pbe {
          return {};
       }
 
-      Own<Scene> scene = std::make_unique<Scene>(false);
+      auto binaryPath = GetBinaryScenePath(path);
+      if (cvBinarySceneCache && fs::exists(binaryPath) && fs::last_write_time(binaryPath) >= fs::last_write_time(path)) {
+         if (auto scene = SceneDeserializeBinary(binaryPath)) {
+            setProgress(1);
+            return scene;
+         }
+      }
 
-      gCurrentDeserializedScene = scene.get();
+      Own<Scene> scene = std::make_unique<Scene>(false);
 
       // todo:
       // GetAssetsPath(path);
       auto deser = Deserializer::FromFile(path);
+      setProgress(0.3f);
+
+      // children of deser refer to it
+      SchemaTable schemas = SchemaTable::Deserialize(deser["schemas"].node);
+      deser.schemas = &schemas;
+      deser.scene = scene.get();
 
       // auto sceneName = deser["sceneName"].As<string>();
 
+      SceneSharedSection shared;
+      SharedSectionDeserialize(deser["shared"], shared);
+
       auto entitiesNode = deser["entities"];
 
-      // on first iteration create all entities
-      for (int i = 0; i < entitiesNode.Size(); ++i) {
-         auto it = entitiesNode[i];
+      scene->ReserveEntities(entitiesNode.Size());
+
+      std::vector<TextNode> entityNodes;
+      std::vector<Entity> entities;
+      entityNodes.reserve(entitiesNode.Size());
+      entities.reserve(entitiesNode.Size());
 
+      // on first iteration create all entities
+      for (Deserializer it : entitiesNode.node) {
          auto uuid = it["uuid"].As<uint64>();
 
          string entityTag;
@@ -464,13 +960,21 @@ namespace pbe {
 
          Entity entity = scene->CreateWithUUID(UUID{ uuid }, Entity{}, entityTag);
          scene->EntityDisableImmediate(entity);
+
+         entityNodes.emplace_back(it.node);
+         entities.emplace_back(entity);
       }
+      setProgress(0.4f);
 
       // on second iteration create all components
-      for (int i = 0; i < entitiesNode.Size(); ++i) {
-         auto it = entitiesNode[i];
-         EntityDeserialize(it, *scene);
+      if (cvParallelSceneLoad) {
+         EntitiesDeserializeParallel(entityNodes, entities, *scene, shared, deser);
+      } else {
+         for (const auto& it : entityNodes) {
+            EntityDeserialize(deser.Child(it), *scene, &shared);
+         }
       }
+      setProgress(0.8f);
 
       entt::entity rootEntityId = entt::null;
       for (auto [e, trans] : scene->ViewAll<SceneTransformComponent>().each()) {
@@ -502,12 +1006,72 @@ namespace pbe {
 
       scene->ProcessDelayedEnable();
 
-      gCurrentDeserializedScene = nullptr;
+      setProgress(1);
+      return scene;
+   }
+
+   struct SceneLoadHandle::State {
+      std::atomic<float> progress = 0;
+      Own<Scene> scene;
+      JobHandle job;
+   };
+
+   bool SceneLoadHandle::Completed() const {
+      return !state || state->job.Completed();
+   }
+
+   float SceneLoadHandle::Progress() const {
+      return state ? state->progress.load(std::memory_order_relaxed) : 0.f;
+   }
 
+   void SceneLoadHandle::Wait() const {
+      if (state) {
+         JobSystem::Get().Wait(state->job);
+      }
+   }
+
+   Own<Scene> SceneLoadHandle::Take() {
+      if (!state) {
+         return {};
+      }
+
+      Wait();
+      auto scene = std::move(state->scene);
+      state = {};
       return scene;
    }
 
+   static std::atomic_int sSceneLoadsInFlight = 0;
+
+   SceneLoadHandle SceneDeserializeAsync(std::string_view path) {
+      SceneLoadHandle handle;
+      handle.state = std::make_shared<SceneLoadHandle::State>();
+
+      ++sSceneLoadsInFlight;
+      handle.state->job = JobSystem::Get().ScheduleBackground([state = handle.state, path = string{ path }] {
+         OPTICK_EVENT("Scene Deserialize Async");
+         state->scene = SceneDeserialize(path, &state->progress);
+         --sSceneLoadsInFlight;
+      });
+
+      return handle;
+   }
+
+   int SceneLoadsInFlight() {
+      return sSceneLoadsInFlight;
+   }
+
    void EntitySerialize(Serializer& ser, const Entity& entity) {
+      EntitySerialize(ser, entity, nullptr);
+   }
+
+   void EntityDeserialize(const Deserializer& deser, Scene& scene) {
+      Deserializer sceneDeser = deser;
+      sceneDeser.scene = &scene;
+      EntityDeserialize(sceneDeser, scene, nullptr);
+   }
+
+   static void EntitySerialize(Serializer& ser, const Entity& entity, const SceneSharedSection* shared) {
       SERIALIZER_MAP(ser);
       {
          auto uuid = (uint64)entity.Get<UUIDComponent>().uuid;
@@ -515,7 +1079,7 @@ namespace pbe {
          ser.KeyValue("uuid", uuid);
 
          if (const auto* c = entity.TryGet<TagComponent>()) {
-            ser.KeyValue("tag", c->tag);
+            ser.KeyValue("tag", c->tag.CStr());
          }
 
          if (!entity.Enabled()) {
@@ -527,19 +1091,24 @@ namespace pbe {
 
          const auto& typer = Typer::Get();
 
-         for (const auto& ci : typer.components) {
+         // only storages with entity. Registration order keeps file stable
+         typer.ForEachComponent(typer.GetComponentMask(entity), [&](const ComponentInfo& ci) {
+            int idx = ci.idx;
             const auto& ti = typer.GetTypeInfo(ci.typeID);
 
-            auto* ptr = (byte*)ci.tryGetConst(entity);
-            if (ptr) {
-               const char* name = ti.name.data();
-               ser.Ser(name, ci.typeID, ptr);
+            if (shared && shared->components[idx].table) {
+               const auto& component = shared->components[idx];
+               ser.KeyValue(ti.name, component.entityHandles[(size_t)entt::to_entity(entity.GetID())]);
+               return;
             }
-         }
+
+            auto* ptr = (const byte*)ci.tryGetConst(entity);
+            ser.Ser(ti.name, ci.typeID, ptr);
+         });
       }
    }
 
-   void EntityDeserialize(const Deserializer& deser, Scene& scene) {
+   static void EntityDeserialize(const Deserializer& deser, Scene& scene, const SceneSharedSection* shared) {
       auto uuid = deser["uuid"].As<uint64>();
 
       Entity entity = scene.GetEntity(uuid);
@@ -560,7 +1129,7 @@ namespace pbe {
          return string{};
       });
 
-      entity.GetOrAdd<TagComponent>().tag = name;
+      entity.SetName(name);
 
       bool enabled = !deser["disabled"];
 
@@ -568,20 +1137,18 @@ namespace pbe {
 
       const auto& typer = Typer::Get();
 
-      // std::array<byte, 128> data; // todo:
-
-      for (const auto& ci : typer.components) {
-         const auto& ti = typer.GetTypeInfo(ci.typeID);
-
-         // ASSERT(ti.typeSizeOf < data.size());
+      // dispatch by keys present in file, not by all registered components
+      for (TextNode node : deser.node) {
+         int idx = typer.FindComponentIdx(node.Key());
+         if (idx < 0) {
+            continue; // uuid, tag, transform or unknown component
+         }
 
-         const char* name = ti.name.data();
+         const auto& ci = typer.components[idx];
 
-         if (auto node = deser[name]) {
-            // todo: use move ctor
-            auto* ptr = (byte*)ci.getOrAdd(entity);
-            deser.Deser(name, ci.typeID, ptr);
-         }
+         // todo: use move ctor
+         auto* ptr = (byte*)ci.getOrAdd(entity);
+         ComponentDeserialize(deser.Child(node), idx, ptr, shared);
       }
 
       if (enabled) {
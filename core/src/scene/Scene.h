@@ -1,10 +1,17 @@
 #pragma once
 
+#include <atomic>
+
 #include <entt/entt.hpp>
 
 #include "core/Core.h"
 #include "core/Ref.h"
+#include "core/Type.h"
+#include "core/UUIDMap.h"
 #include "math/Types.h"
+#include "ChangeVersions.h"
+#include "NameIndex.h"
+#include "SystemScheduler.h"
 
 
 namespace pbe {
@@ -18,6 +25,8 @@ namespace pbe {
 
    class Entity;
 
+   struct ComponentListener;
+
    struct DelayedDisableMarker {};
    struct DelayedEnableMarker {};
    struct DisableMarker {};
@@ -33,7 +42,15 @@ namespace pbe {
       // todo: to private
       Entity CreateWithUUID(UUID uuid, const Entity& parent, std::string_view name = {});
 
+      // create entities with copies of prototype components and local transform. Only prototype itself is copied,
+      // its children are not. Components are added by storage ranges, systems get all entities in one OnEntityEnable
+      std::vector<Entity> CreateBatch(int count, const Entity& parent = {}, const Entity& prototype = {});
+
       Entity GetEntity(UUID uuid);
+      // entities[i] = GetEntity(uuids[i])
+      void GetEntities(std::span<const UUID> uuids, std::span<Entity> entities);
+
+      void ReserveEntities(int nEntities);
 
       Entity GetRootEntity();
       void SetRootEntity(const Entity& entity);
@@ -98,6 +115,54 @@ namespace pbe {
          }
       }
 
+      // raw registry storage, for batch processing
+      template<typename Component>
+      auto& Storage() {
+         return registry.storage<Component>();
+      }
+
+      // nullptr if component was never used in scene
+      template<typename Component>
+      const auto* TryStorage() const {
+         return registry.storage<Component>();
+      }
+
+      // calls func(TypeID) for every storage that contains entity
+      template<typename Func>
+      void ForEachComponentStorage(entt::entity entity, Func&& func) const {
+         for (auto [id, storage] : registry.storage()) {
+            if (storage.contains(entity)) {
+               func((TypeID)id);
+            }
+         }
+      }
+
+      // listener gets add, patch and remove of registered components, uuid, tag and transform
+      void ConnectComponentListener(ComponentListener& listener, bool connect = true);
+
+      // Add, MarkComponentUpdated and remove of registered components, tag and transform setters are versioned.
+      // Consumer keeps version returned by NextChangeVersion and later processes only entities changed since it
+      uint NextChangeVersion() { return changeVersion++; }
+
+      void MarkChanged(TypeID typeID, entt::entity entity);
+      template<typename Component>
+      void MarkChanged(entt::entity entity) {
+         MarkChanged(GetTypeID<Component>(), entity);
+      }
+      // called by transform setters, may be called from parallel scripts for different entities
+      void MarkTransformChanged(entt::entity entity) { transformVersions->Mark(entity, changeVersion); }
+
+      // nullptr if type is not versioned
+      const ChangeVersions* GetChangeVersions(TypeID typeID) const;
+      ChangeVersions* GetChangeVersions(TypeID typeID);
+
+      template<typename Component, typename Func>
+      void ForEachChangedSince(uint version, Func&& func) const {
+         if (const auto* versions = GetChangeVersions(GetTypeID<Component>())) {
+            versions->ForEachChangedSince(version, std::forward<Func>(func));
+         }
+      }
+
       template<typename Component>
       void ClearComponent() {
          registry.clear<Component>();
@@ -109,13 +174,22 @@ namespace pbe {
       // call this every frame
       void OnTick();
 
+      // recalculate world space cache of transforms changed since the last call. Main thread, without running systems
+      void UpdateWorldTransforms();
+
       void OnStart();
       void OnUpdate(float dt);
       void OnStop();
 
       void AddSystem(Own<System>&& system);
 
+      // per system update time
+      const SystemScheduler& GetSystemScheduler() const { return systemScheduler; }
+
+      // enabled entity with name
       Entity FindByName(std::string_view name);
+      // entities with name starting with prefix, ordered by name
+      std::vector<Entity> FindByNamePrefix(std::string_view prefix);
 
       uint EntitiesCount() const;
 
@@ -126,37 +200,130 @@ namespace pbe {
 
       Own<DbgRend> dbgRend; // todo:
 
-      static Scene* GetCurrentDeserializedScene();
-
    private:
       entt::registry registry;
       entt::entity rootEntityId { entt::null };
 
-      std::unordered_map<uint64, entt::entity> uuidToEntities;
+      UUIDMap<entt::entity> uuidToEntities;
+      NameIndex nameIndex;
+
+      // created in ctor for all versioned types, map is not changed later
+      std::unordered_map<TypeID, ChangeVersions> changeVersions;
+      ChangeVersions* transformVersions = nullptr;
+      uint changeVersion = 1;
+      // transforms changed after it may have dirty world cache
+      uint worldVersion = 0;
+
+      struct ChangeVersionsListener;
+      Own<ChangeVersionsListener> changeVersionsListener;
 
       // todo: move to scene component?
       std::vector<Own<System>> systems;
+      SystemScheduler systemScheduler;
 
       void EntityDisableImmediate(Entity& entity);
 
+      // doesn't change version, so it may run as system node
+      void UpdateWorldTransformsSince(uint version);
+
       struct DuplicateContext {
          entt::entity enttEntity{ entt::null };
          bool enabled = false;
       };
 
-      void DuplicateHierEntitiesWithMap(Entity& dst, const Entity& src, bool copyUUID, std::unordered_map<UUID, DuplicateContext>& hierEntitiesMap);
-      void Duplicate(Entity& dst, const Entity& src, bool copyUUID, std::unordered_map<UUID, DuplicateContext>& hierEntitiesMap);
-      void DuplicateEntityEnable(Entity& root, std::unordered_map<UUID, DuplicateContext>& hierEntitiesMap);
+      void DuplicateHierEntitiesWithMap(Entity& dst, const Entity& src, bool copyUUID, UUIDMap<DuplicateContext>& hierEntitiesMap);
+      void Duplicate(Entity& dst, const Entity& src, bool copyUUID, UUIDMap<DuplicateContext>& hierEntitiesMap);
+      void DuplicateEntityEnable(Entity& root, UUIDMap<DuplicateContext>& hierEntitiesMap);
 
       friend Entity;
-      friend CORE_API Own<Scene> SceneDeserialize(std::string_view path);
+      friend CORE_API Own<Scene> SceneDeserialize(std::string_view path, std::atomic<float>* progress);
+      friend CORE_API Own<Scene> SceneDeserializeBinary(std::span<const byte> data, std::string_view path, bool convertLayouts);
    };
 
+   // append all components of src to empty or non-empty dst storage, entity e of src scene becomes remap[to_entity(e)].
+   // trivially copyable components are copied by pages if dst is empty and nobody listens construct
+   template<typename T>
+   void CopyComponentStorage(const entt::storage_for_t<T>& src, entt::storage_for_t<T>& dst, std::span<const entt::entity> remap) {
+      static_assert(!entt::component_traits<T>::in_place_delete, "storage must be packed");
+
+      std::vector<entt::entity> dstEntities;
+      dstEntities.reserve(src.size());
+      for (auto e : std::span{ src.data(), src.size() }) {
+         dstEntities.emplace_back(remap[entt::to_entity(e)]);
+      }
+
+      if constexpr (std::is_empty_v<T>) {
+         dst.insert(dstEntities.begin(), dstEntities.end());
+      } else {
+         if constexpr (std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>) {
+            if (dst.empty() && dst.on_construct().empty()) {
+               constexpr size_t pageSize = entt::component_traits<T>::page_size;
+
+               dst.insert(dstEntities.begin(), dstEntities.end());
+
+               // same packed order and page size in both storages
+               auto srcPages = src.raw();
+               auto dstPages = dst.raw();
+               for (size_t begin = 0; begin < src.size(); begin += pageSize) {
+                  size_t count = std::min(pageSize, src.size() - begin);
+                  std::memcpy(dstPages[begin / pageSize], srcPages[begin / pageSize], count * sizeof(T));
+               }
+               return;
+            }
+         }
+
+         // rbegin iterates in packed order, the same as data()
+         dst.insert(dstEntities.begin(), dstEntities.end(), src.rbegin());
+      }
+   }
+
    CORE_API void SceneSerialize(std::string_view path, Scene& scene);
-   CORE_API Own<Scene> SceneDeserialize(std::string_view path);
+   // progress is updated from 0 to 1 while loading
+   CORE_API Own<Scene> SceneDeserialize(std::string_view path, std::atomic<float>* progress = nullptr);
+
+   class CORE_API SceneLoadHandle {
+   public:
+      SceneLoadHandle() = default;
+
+      bool Valid() const { return (bool)state; }
+      explicit operator bool() const { return Valid(); }
+
+      bool Completed() const;
+      // 0..1
+      float Progress() const;
+      void Wait() const;
+
+      // loaded scene, handle becomes invalid. Waits if loading is not completed. nullptr if loading failed
+      Own<Scene> Take();
+
+   private:
+      struct State;
+      std::shared_ptr<State> state;
+
+      friend CORE_API SceneLoadHandle SceneDeserializeAsync(std::string_view path);
+   };
+
+   // scene is deserialized to detached Scene on worker thread, physics actors are created there too.
+   // Owner swaps scene in when handle is completed, so frame is never blocked by loading
+   CORE_API SceneLoadHandle SceneDeserializeAsync(std::string_view path);
+   // count of SceneDeserializeAsync not completed yet
+   CORE_API int SceneLoadsInFlight();
+
+   // binary scene '.scnb'. it is saved alongside yaml scene and used as load cache while it is newer than yaml.
+   // Both are skipped while 'scene/binary cache' is off
+   // false if some component can't be stored in binary
+   CORE_API bool SceneSerializeBinary(std::string_view path, Scene& scene);
+   CORE_API bool SceneSerializeBinary(Scene& scene, std::vector<byte>& data);
+   // nullptr if file is corrupted or layout of some component was changed
+   CORE_API Own<Scene> SceneDeserializeBinary(std::string_view path);
+   // path is only for messages. convertLayouts - components with changed layout are converted by text, with renamed
+   // fields and migrations, and removed components are skipped instead of rejecting data, used to keep scene in
+   // memory over dll reload
+   CORE_API Own<Scene> SceneDeserializeBinary(std::span<const byte> data, std::string_view path, bool convertLayouts = false);
 
    // todo: move to Entity.h
    CORE_API void EntitySerialize(Serializer& ser, const Entity& entity);
+   // entity references are resolved in scene
    CORE_API void EntityDeserialize(const Deserializer& deser, Scene& scene);
 
 }
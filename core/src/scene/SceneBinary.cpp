@@ -0,0 +1,650 @@
+#include "pch.h"
+#include "Scene.h"
+
+#include <deque>
+
+#include "Component.h"
+#include "Entity.h"
+#include "typer/Serialize.h"
+#include "typer/Typer.h"
+
+
+namespace pbe {
+
+   // .scnb file:
+   //    ScnbHeader
+   //    ScnbEntity[nEntities] - hierarchy pre-order, parent is always before its children
+   //    blocks, one per component type: ScnbBlock, ScnbLeaf[nLeaves], uint entity indices[count], records[count * stride]
+   //    strings: uint offsets[nStrings], null terminated chars
+   // record is flat list of simple fields of component, strings are indices in string table,
+   // entity refs are indices in entity array, so loading is one file read and one pass over blocks.
+   // Leaves are described by field path and simple type, so block of changed component may be converted by text
+   // instead of rejected. File keeps schemas of types as text, so converted records are renamed and migrated
+   // like text scene
+
+   constexpr uint SCNB_MAGIC = 0x424E4353; // 'SCNB'
+   constexpr uint SCNB_VERSION = 4;
+   constexpr uint SCNB_NONE = UINT32_MAX;
+
+   struct ScnbHeader {
+      uint magic = SCNB_MAGIC;
+      uint version = SCNB_VERSION;
+      uint nEntities = 0;
+      uint nBlocks = 0;
+      uint nStrings = 0;
+      uint entitiesOffset = 0;
+      uint blocksOffset = 0;
+      uint stringsOffset = 0;
+      uint schemas = SCNB_NONE; // string, 'schemas' section of text scene
+   };
+
+   struct ScnbEntity {
+      uint64 uuid;
+      uint tag;
+      uint parent;
+      uint disabled;
+      uint pad = 0;
+   };
+
+   struct ScnbBlock {
+      uint64 layoutHash;
+      uint typeName;
+      uint count;
+      uint stride;
+      uint nLeaves;
+   };
+
+   struct ScnbLeaf {
+      uint name; // field path
+      uint type; // name of simple type
+      uint kind;
+      uint size;
+   };
+
+   struct ScnbWriter {
+      std::vector<byte> data;
+
+      uint Pos() const { return (uint)data.size(); }
+
+      void WriteBytes(const void* src, size_t size) {
+         data.insert(data.end(), (const byte*)src, (const byte*)src + size);
+      }
+
+      template<typename T>
+      void Write(const T& value) {
+         WriteBytes(&value, sizeof(T));
+      }
+
+      void Align(uint alignment) {
+         data.resize((data.size() + alignment - 1) / alignment * alignment);
+      }
+   };
+
+   struct ScnbStringTable {
+      std::unordered_map<std::string_view, uint> indices;
+      std::vector<std::string_view> strings;
+
+      // str must be alive until table is written
+      uint Add(std::string_view str) {
+         auto [it, inserted] = indices.try_emplace(str, (uint)strings.size());
+         if (inserted) {
+            strings.emplace_back(str);
+         }
+         return it->second;
+      }
+   };
+
+   bool SceneSerializeBinary(Scene& scene, std::vector<byte>& data) {
+      const auto& typer = Typer::Get();
+
+      Entity root = scene.GetRootEntity();
+      if (!root) {
+         return false;
+      }
+
+      std::vector<Entity> entities;
+      entities.reserve(scene.EntitiesCount());
+      for (Entity e = root; e; e = e.GetTransform().NextInHierarchy(root)) {
+         entities.emplace_back(e);
+      }
+
+      // entt entity index -> index in file
+      std::vector<uint> fileIndices;
+      for (uint i = 0; i < (uint)entities.size(); ++i) {
+         auto idx = entt::to_entity(entities[i].GetID());
+         if (idx >= fileIndices.size()) {
+            fileIndices.resize(idx + 1, SCNB_NONE);
+         }
+         fileIndices[idx] = i;
+      }
+
+      auto getFileIndex = [&](const Entity& e) {
+         if (!e.Valid() || e.GetScene() != &scene) {
+            return SCNB_NONE;
+         }
+         auto idx = entt::to_entity(e.GetID());
+         return idx < fileIndices.size() ? fileIndices[idx] : SCNB_NONE;
+      };
+
+      ScnbStringTable strings;
+      ScnbWriter writer;
+
+      ScnbHeader header;
+      writer.Write(header);
+
+      header.nEntities = (uint)entities.size();
+      header.entitiesOffset = writer.Pos();
+      for (const auto& e : entities) {
+         writer.Write(ScnbEntity{
+            .uuid = (uint64)e.GetUUID(),
+            .tag = strings.Add(e.GetName()),
+            .parent = getFileIndex(e.GetTransform().parent),
+            .disabled = !e.Enabled(),
+         });
+      }
+
+      // leaf names must be alive until string table is written
+      std::deque<std::vector<string>> leafNames;
+
+      auto writeBlock = [&](const TypeInfo& ti, auto&& getComponent) {
+         BinaryLayout layout;
+         auto& names = leafNames.emplace_back();
+         if (!BuildBinaryLayout(ti, 0, layout, &names)) {
+            WARN("Type '{}' can't be stored in binary scene", ti.name);
+            return false;
+         }
+
+         std::vector<uint> owners;
+         std::vector<const byte*> components;
+         for (uint i = 0; i < (uint)entities.size(); ++i) {
+            if (const byte* component = getComponent(entities[i])) {
+               owners.emplace_back(i);
+               components.emplace_back(component);
+            }
+         }
+
+         if (owners.empty()) {
+            return true;
+         }
+
+         writer.Align(alignof(ScnbBlock));
+         writer.Write(ScnbBlock{
+            .layoutHash = layout.hash,
+            .typeName = strings.Add(ti.name),
+            .count = (uint)owners.size(),
+            .stride = layout.stride,
+            .nLeaves = (uint)layout.leaves.size(),
+         });
+         for (size_t i = 0; i < layout.leaves.size(); ++i) {
+            const auto& leaf = layout.leaves[i];
+            writer.Write(ScnbLeaf{
+               .name = strings.Add(names[i]),
+               .type = strings.Add(typer.GetTypeInfo(leaf.typeID).name),
+               .kind = (uint)leaf.kind,
+               .size = leaf.size,
+            });
+         }
+         writer.WriteBytes(owners.data(), owners.size() * sizeof(uint));
+
+         for (const byte* component : components) {
+            for (const auto& leaf : layout.leaves) {
+               const byte* value = component + leaf.offset;
+
+               switch (leaf.kind) {
+               case BinaryKind::Raw:
+                  writer.WriteBytes(value, leaf.size);
+                  break;
+               case BinaryKind::String:
+                  writer.Write(strings.Add(*(const string*)value));
+                  break;
+               case BinaryKind::StringID:
+                  writer.Write(strings.Add(((const StringID*)value)->Str()));
+                  break;
+               case BinaryKind::Entity:
+                  writer.Write(getFileIndex(*(const Entity*)value));
+                  break;
+               default:
+                  UNIMPLEMENTED();
+               }
+            }
+         }
+
+         ++header.nBlocks;
+         return true;
+      };
+
+      header.blocksOffset = writer.Pos();
+
+      bool success = writeBlock(typer.GetTypeInfo<SceneTransformComponent>(),
+         [](const Entity& e) { return (const byte*)&e.GetTransform(); });
+
+      for (const auto& ci : typer.components) {
+         success = success && writeBlock(typer.GetTypeInfo(ci.typeID),
+            [&](const Entity& e) { return (const byte*)ci.tryGetConst(e); });
+      }
+
+      if (!success) {
+         return false;
+      }
+
+      Serializer schemas;
+      {
+         SERIALIZER_MAP(schemas);
+         SchemaTable::Serialize(schemas);
+      }
+      header.schemas = strings.Add(schemas.Str());
+
+      header.nStrings = (uint)strings.strings.size();
+      header.stringsOffset = writer.Pos();
+
+      uint offset = 0;
+      for (auto str : strings.strings) {
+         writer.Write(offset);
+         offset += (uint)str.size() + 1;
+      }
+      for (auto str : strings.strings) {
+         writer.WriteBytes(str.data(), str.size());
+         writer.Write('\0');
+      }
+
+      std::memcpy(writer.data.data(), &header, sizeof(header));
+
+      data = std::move(writer.data);
+      return true;
+   }
+
+   bool SceneSerializeBinary(std::string_view path, Scene& scene) {
+      std::vector<byte> data;
+      if (!SceneSerializeBinary(scene, data)) {
+         return false;
+      }
+
+      std::ofstream fout{ path.data(), std::ios::binary };
+      fout.write((const char*)data.data(), data.size());
+
+      return fout.good();
+   }
+
+   struct ScnbReader {
+      std::span<const byte> data;
+      size_t pos = 0;
+      bool ok = true;
+
+      // nullptr if out of file
+      const byte* ReadBytes(size_t size) {
+         if (!ok || pos > data.size() || size > data.size() - pos) {
+            ok = false;
+            return nullptr;
+         }
+         const byte* bytes = data.data() + pos;
+         pos += size;
+         return bytes;
+      }
+
+      template<typename T>
+      T Read() {
+         T value{};
+         if (auto bytes = ReadBytes(sizeof(T))) {
+            std::memcpy(&value, bytes, sizeof(T));
+         }
+         return value;
+      }
+
+      void Align(size_t alignment) {
+         pos = (pos + alignment - 1) / alignment * alignment;
+         ok = ok && pos <= data.size();
+      }
+   };
+
+   Own<Scene> SceneDeserializeBinary(std::string_view path) {
+      std::ifstream fin{ path.data(), std::ios::binary | std::ios::ate };
+      if (!fin) {
+         return {};
+      }
+
+      std::vector<byte> data((size_t)fin.tellg());
+      fin.seekg(0);
+      fin.read((char*)data.data(), data.size());
+      if (!fin) {
+         return {};
+      }
+
+      return SceneDeserializeBinary(data, path);
+   }
+
+   Own<Scene> SceneDeserializeBinary(std::span<const byte> data, std::string_view path, bool convertLayouts) {
+      ScnbReader reader{ data };
+
+      auto header = reader.Read<ScnbHeader>();
+      if (!reader.ok || header.magic != SCNB_MAGIC || header.version != SCNB_VERSION) {
+         WARN("'{}' is not binary scene or has old version", path);
+         return {};
+      }
+
+      // strings
+      reader.pos = header.stringsOffset;
+      auto stringOffsets = reader.ReadBytes(header.nStrings * sizeof(uint));
+      const char* chars = (const char*)data.data() + reader.pos;
+      size_t charsSize = data.size() - std::min(reader.pos, data.size());
+      if (!reader.ok || (header.nStrings > 0 && (charsSize == 0 || chars[charsSize - 1] != '\0'))) {
+         WARN("Binary scene '{}' is corrupted", path);
+         return {};
+      }
+
+      auto getString = [&](uint idx) -> const char* {
+         if (idx >= header.nStrings) {
+            return nullptr;
+         }
+         uint offset;
+         std::memcpy(&offset, stringOffsets + idx * sizeof(uint), sizeof(uint));
+         return offset < charsSize ? chars + offset : nullptr;
+      };
+
+      // entities
+      reader.pos = header.entitiesOffset;
+      auto entityRecords = reader.ReadBytes(header.nEntities * sizeof(ScnbEntity));
+      if (!reader.ok || header.nEntities == 0) {
+         WARN("Binary scene '{}' is corrupted", path);
+         return {};
+      }
+
+      // leaf of file, for conversion of record by text
+      struct FileLeaf {
+         std::string_view name;
+         const TypeInfo* ti; // simple type, nullptr if it is removed
+         ScnbLeaf desc;
+         uint offset; // in record
+      };
+
+      // validate all blocks before scene creation, so stale cache can be rejected
+      struct Block {
+         const ComponentInfo* ci = nullptr; // nullptr for SceneTransformComponent
+         BinaryLayout layout;
+         // offset of leaf value in record
+         std::vector<uint> srcOffsets;
+         // not nullptr - layout was changed, record is written as text by fileLeaves and deserialized by Typer,
+         // so fields are matched by current and old names and migrations are applied
+         const TypeInfo* textTi = nullptr;
+         std::vector<FileLeaf> fileLeaves;
+         ScnbBlock desc;
+         const byte* owners = nullptr;
+         const byte* records = nullptr;
+      };
+      std::vector<Block> blocks;
+      blocks.reserve(header.nBlocks);
+
+      const auto& typer = Typer::Get();
+
+      // leaf types of converted blocks
+      std::unordered_map<std::string_view, const TypeInfo*> simpleTypes;
+      if (convertLayouts) {
+         for (const auto& [_, ti] : typer.types) {
+            if (ti.IsSimpleType() && ti.binaryKind != BinaryKind::None) {
+               simpleTypes[ti.name] = &ti;
+            }
+         }
+      }
+
+      reader.pos = header.blocksOffset;
+      for (uint iBlock = 0; iBlock < header.nBlocks; ++iBlock) {
+         Block block;
+
+         reader.Align(alignof(ScnbBlock));
+         block.desc = reader.Read<ScnbBlock>();
+         auto leafRecords = reader.ReadBytes(block.desc.nLeaves * sizeof(ScnbLeaf));
+         if (!reader.ok) {
+            WARN("Binary scene '{}' is corrupted", path);
+            return {};
+         }
+
+         const char* typeName = getString(block.desc.typeName);
+         if (!typeName) {
+            WARN("Binary scene '{}' is corrupted", path);
+            return {};
+         }
+
+         const TypeInfo* ti = nullptr;
+         if (typeName == typer.GetTypeInfo<SceneTransformComponent>().name) {
+            ti = &typer.GetTypeInfo<SceneTransformComponent>();
+         } else if ((block.ci = typer.FindComponent(std::string_view{ typeName }))) {
+            ti = &typer.GetTypeInfo(block.ci->typeID);
+         }
+
+         block.owners = reader.ReadBytes(block.desc.count * sizeof(uint));
+         block.records = reader.ReadBytes((size_t)block.desc.count * block.desc.stride);
+         if (!reader.ok) {
+            WARN("Binary scene '{}' is corrupted", path);
+            return {};
+         }
+
+         bool validLayout = ti && BuildBinaryLayout(*ti, 0, block.layout);
+
+         if (validLayout && block.layout.hash == block.desc.layoutHash && block.layout.stride == block.desc.stride) {
+            // same layout, leaves are in the same order
+            uint offset = 0;
+            for (const auto& leaf : block.layout.leaves) {
+               block.srcOffsets.emplace_back(offset);
+               offset += leaf.FileSize();
+            }
+         } else if (convertLayouts) {
+            if (!ti) {
+               INFO("Component '{}' of binary scene '{}' is removed, it is skipped", typeName, path);
+               continue;
+            }
+
+            std::vector<FileLeaf> fileLeaves;
+            uint offset = 0;
+            for (uint i = 0; i < block.desc.nLeaves; ++i) {
+               ScnbLeaf leaf;
+               std::memcpy(&leaf, leafRecords + i * sizeof(ScnbLeaf), sizeof(ScnbLeaf));
+               const char* name = getString(leaf.name);
+               const char* type = getString(leaf.type);
+               if (!name || !type) {
+                  WARN("Binary scene '{}' is corrupted", path);
+                  return {};
+               }
+               auto it = simpleTypes.find(type);
+               fileLeaves.push_back({ name, it != simpleTypes.end() ? it->second : nullptr, leaf, offset });
+               offset += BinaryLeaf{ 0, leaf.size, (BinaryKind)leaf.kind }.FileSize();
+            }
+            if (offset != block.desc.stride) {
+               WARN("Binary scene '{}' is corrupted", path);
+               return {};
+            }
+
+            block.textTi = ti;
+            block.fileLeaves = std::move(fileLeaves);
+            block.layout = {}; // no leaves are copied as bytes
+
+            INFO("Component '{}' of binary scene '{}' was changed, it is converted by text", typeName, path);
+         } else {
+            INFO("Binary scene '{}' is outdated, component '{}' was changed", path, typeName);
+            return {};
+         }
+
+         blocks.emplace_back(std::move(block));
+      }
+
+      // of file, only for converted blocks
+      Deserializer schemasDeser;
+      SchemaTable schemas;
+      if (std::ranges::any_of(blocks, [](const Block& block) { return block.textTi != nullptr; })) {
+         if (const char* str = getString(header.schemas)) {
+            schemasDeser = Deserializer::FromStr(str);
+            schemas = SchemaTable::Deserialize(schemasDeser["schemas"].node);
+         }
+      }
+
+      Own<Scene> scene = std::make_unique<Scene>(false);
+      scene->ReserveEntities(header.nEntities);
+
+      std::vector<Entity> entities(header.nEntities);
+      std::vector<bool> enabled(header.nEntities);
+
+      for (uint i = 0; i < header.nEntities; ++i) {
+         ScnbEntity record;
+         std::memcpy(&record, entityRecords + i * sizeof(ScnbEntity), sizeof(ScnbEntity));
+
+         const char* tag = getString(record.tag);
+         bool validParent = i == 0 ? record.parent == SCNB_NONE : record.parent < i;
+         if (!tag || !validParent) {
+            WARN("Binary scene '{}' is corrupted", path);
+            return {};
+         }
+
+         Entity entity = scene->CreateWithUUID(UUID{ record.uuid }, Entity{}, tag);
+         scene->EntityDisableImmediate(entity);
+
+         if (record.parent != SCNB_NONE) {
+            entities[record.parent].GetTransform().AddChild(entity, -1, true);
+         }
+
+         entities[i] = entity;
+         enabled[i] = !record.disabled;
+      }
+
+      scene->SetRootEntity(entities[0]);
+
+      // record as map of field paths of file, e.g. 'light.color' is 'light: {color: ...}'. Leaves with removed
+      // type are skipped, so field keeps default value
+      auto recordToText = [&](const Block& block, const byte* record, Serializer& ser) {
+         std::vector<std::string_view> path; // of opened maps
+         std::vector<std::string_view> parts;
+
+         ser.out.BeginMap();
+
+         for (const auto& leaf : block.fileLeaves) {
+            const byte* src = record + leaf.offset;
+            auto kind = (BinaryKind)leaf.desc.kind;
+
+            uint idx = 0;
+            if (kind != BinaryKind::Raw) {
+               std::memcpy(&idx, src, sizeof(uint));
+            }
+
+            const char* str = nullptr;
+            if (kind == BinaryKind::Raw) {
+               if (!leaf.ti || leaf.ti->binaryKind != BinaryKind::Raw || leaf.ti->typeSizeOf != (int)leaf.desc.size || !leaf.ti->serialize) {
+                  continue;
+               }
+            } else if (kind == BinaryKind::String || kind == BinaryKind::StringID) {
+               if (!(str = getString(idx))) {
+                  continue;
+               }
+            } else if (kind != BinaryKind::Entity) {
+               continue;
+            }
+
+            parts.clear();
+            for (size_t begin = 0; begin <= leaf.name.size(); ) {
+               size_t end = std::min(leaf.name.find('.', begin), leaf.name.size());
+               parts.emplace_back(leaf.name.substr(begin, end - begin));
+               begin = end + 1;
+            }
+
+            size_t common = 0;
+            while (common < path.size() && common + 1 < parts.size() && path[common] == parts[common]) {
+               ++common;
+            }
+            for (; path.size() > common; path.pop_back()) {
+               ser.out.EndMap();
+            }
+            for (; path.size() + 1 < parts.size(); path.emplace_back(parts[path.size()])) {
+               ser.out.Key(parts[path.size()]);
+               ser.out.BeginMap();
+            }
+
+            ser.out.Key(parts.back());
+            switch (kind) {
+            case BinaryKind::Raw:
+               leaf.ti->serialize(ser, src);
+               break;
+            case BinaryKind::String:
+            case BinaryKind::StringID:
+               ser.out.Value(str);
+               break;
+            case BinaryKind::Entity:
+               ser.out.Value(idx < header.nEntities ? (uint64)entities[idx].GetUUID() : (uint64)entt::null);
+               break;
+            default:
+               UNIMPLEMENTED();
+            }
+         }
+
+         for (; !path.empty(); path.pop_back()) {
+            ser.out.EndMap();
+         }
+         ser.out.EndMap();
+      };
+
+      for (const auto& block : blocks) {
+         bool textSuccess = true;
+
+         for (uint iRecord = 0; iRecord < block.desc.count; ++iRecord) {
+            uint owner;
+            std::memcpy(&owner, block.owners + iRecord * sizeof(uint), sizeof(uint));
+            if (owner >= header.nEntities) {
+               WARN("Binary scene '{}' is corrupted", path);
+               return {};
+            }
+
+            Entity& entity = entities[owner];
+            byte* component = block.ci ? (byte*)block.ci->add(entity) : (byte*)&entity.GetTransform();
+
+            const byte* record = block.records + (size_t)iRecord * block.desc.stride;
+
+            if (block.textTi) {
+               Serializer ser;
+               recordToText(block, record, ser);
+
+               Deserializer deser = Deserializer::FromStr(ser.Str());
+               deser.schemas = &schemas;
+               deser.scene = scene.get();
+               textSuccess &= typer.Deserialize(deser, {}, block.textTi->typeID, component);
+            }
+
+            for (size_t iLeaf = 0; iLeaf < block.layout.leaves.size(); ++iLeaf) {
+               const auto& leaf = block.layout.leaves[iLeaf];
+               const byte* src = record + block.srcOffsets[iLeaf];
+               byte* value = component + leaf.offset;
+
+               if (leaf.kind == BinaryKind::Raw) {
+                  std::memcpy(value, src, leaf.size);
+               } else {
+                  uint idx;
+                  std::memcpy(&idx, src, sizeof(uint));
+
+                  if (leaf.kind == BinaryKind::Entity) {
+                     *(Entity*)value = idx < header.nEntities ? entities[idx] : Entity{};
+                  } else if (const char* str = getString(idx)) {
+                     if (leaf.kind == BinaryKind::String) {
+                        *(string*)value = str;
+                     } else {
+                        *(StringID*)value = StringID{ str };
+                     }
+                  }
+               }
+            }
+
+            if (!block.ci) {
+               entity.GetTransform().MarkWorldDirty();
+            }
+         }
+
+         if (!textSuccess) {
+            WARN("Component '{}' of binary scene '{}' is converted by text with errors", block.textTi->name, path);
+         }
+      }
+
+      for (uint i = 0; i < header.nEntities; ++i) {
+         if (enabled[i]) {
+            scene->EntityEnable(entities[i], false);
+         }
+      }
+
+      scene->ProcessDelayedEnable();
+
+      return scene;
+   }
+
+}
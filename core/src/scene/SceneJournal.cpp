@@ -0,0 +1,435 @@
+#include "pch.h"
+#include "SceneJournal.h"
+
+#include "Component.h"
+#include "Entity.h"
+#include "Scene.h"
+#include "core/CVar.h"
+#include "core/Profiler.h"
+#include "fs/FileSystem.h"
+#include "typer/Serialize.h"
+
+
+namespace pbe {
+
+   CVarValue<float> cvJournalFlushInterval{ "scene/journal/flush interval", 1.f };
+   CVarValue<int> cvJournalCompactKb{ "scene/journal/compact kb", 8 * 1024 };
+
+   // Journal is sequence of records: uint size and text of record. Record is one of:
+   // 'destroyed: uuid', 'created: entity' (as in scene file) or patch of entity: 'uuid' with own state
+   // (tag, enabled, local transform), changed components, removed components and children order.
+   // Patches are replayed in order of writing, so replay of records older than snapshot ends with snapshot state.
+   // Size prefix lets reader drop torn record, written during crash
+
+   static string GetJournalPath(string_view scenePath) {
+      return fs::path{ scenePath }.replace_extension(".journal").string();
+   }
+
+   static string GetSnapshotPath(string_view scenePath) {
+      return fs::path{ scenePath }.replace_extension(".autosave.scn").string();
+   }
+
+   static string GetBinaryPath(string_view scenePath) {
+      return fs::path{ scenePath }.replace_extension(".scnb").string();
+   }
+
+   SceneJournal::SceneJournal(Scene& scene, std::string_view scenePath)
+      : scene(scene), journalPath(GetJournalPath(scenePath)), snapshotPath(GetSnapshotPath(scenePath)) {
+      scene.ConnectComponentListener(*this);
+   }
+
+   SceneJournal::~SceneJournal() {
+      scene.ConnectComponentListener(*this, false);
+
+      if (writeJob) {
+         JobSystem::Get().Wait(writeJob);
+      }
+
+      // closed without crash, unsaved changes are discarded as before
+      RemoveFiles();
+   }
+
+   SceneJournal::EntityChange& SceneJournal::GetChange(UUID uuid) {
+      auto& change = changed[(uint64)uuid];
+      if (!change.queued) {
+         change.queued = true;
+         changedOrder.emplace_back(uuid);
+      }
+      return change;
+   }
+
+   void SceneJournal::MarkChanged(UUID uuid) {
+      GetChange(uuid).state = true;
+   }
+
+   void SceneJournal::MarkParentChanged(UUID uuid) {
+      GetChange(uuid).parent = true;
+   }
+
+   void SceneJournal::Update(float dt) {
+      flushTime += dt;
+      if (flushTime < cvJournalFlushInterval) {
+         return;
+      }
+      flushTime = 0;
+
+      Flush();
+
+      if (journalSize > (size_t)cvJournalCompactKb * 1024) {
+         Compact();
+      }
+   }
+
+   void SceneJournal::Flush() {
+      if (changedOrder.empty()) {
+         return;
+      }
+
+      OPTICK_EVENT("Scene Journal Flush");
+
+      const auto& typer = Typer::Get();
+
+      string buffer;
+
+      // changedOrder grows while iterating, moved or created entity marks children order of its parent
+      for (size_t i = 0; i < changedOrder.size(); ++i) {
+         UUID uuid = changedOrder[i];
+
+         EntityChange change = std::move(*changed.Find((uint64)uuid));
+         *changed.Find((uint64)uuid) = {};
+
+         Serializer ser;
+         {
+            SERIALIZER_MAP(ser);
+
+            Entity entity = scene.GetEntity(uuid);
+            if (entity && (change.created || change.parent)) {
+               if (Entity parent = entity.GetTransform().parent) {
+                  GetChange(parent.GetUUID()).children = true;
+               }
+            }
+
+            if (!entity) {
+               ser.KeyValue("destroyed", (uint64)uuid);
+            } else if (change.created) {
+               ser.Key("created");
+               EntitySerialize(ser, entity);
+            } else {
+               ser.KeyValue("uuid", (uint64)uuid);
+
+               if (change.state) {
+                  const auto& trans = entity.GetTransform();
+                  ser.KeyValue("tag", entity.GetName());
+                  ser.KeyValue("enabled", entity.Enabled());
+                  ser.Ser("position", trans.LocalPosition());
+                  ser.Ser("rotation", trans.LocalRotation());
+                  ser.Ser("scale", trans.LocalScale());
+               }
+
+               std::ranges::sort(change.components);
+               auto [last, end] = std::ranges::unique(change.components);
+               change.components.erase(last, end);
+
+               std::vector<string_view> removed;
+               if (!change.components.empty()) {
+                  ser.Key("components");
+                  SERIALIZER_MAP(ser);
+
+                  for (TypeID typeID : change.components) {
+                     const auto* ci = typer.FindComponent(typeID);
+                     const auto& ti = typer.GetTypeInfo(typeID);
+                     if (const auto* ptr = (const byte*)ci->tryGetConst(entity)) {
+                        ser.Ser(ti.name, typeID, ptr);
+                     } else {
+                        removed.emplace_back(ti.name);
+                     }
+                  }
+               }
+
+               if (!removed.empty()) {
+                  ser.Key("removed");
+                  SERIALIZER_FLOW_SEQ(ser);
+                  for (auto name : removed) {
+                     ser.out.Value(name);
+                  }
+               }
+
+               if (change.children) {
+                  ser.Key("children");
+                  SERIALIZER_FLOW_SEQ(ser);
+                  for (auto child : entity.GetTransform().Children()) {
+                     ser.out.Value((uint64)child.GetUUID());
+                  }
+               }
+            }
+         }
+
+         string_view text = ser.Str();
+         uint size = (uint)text.size();
+         buffer.append((const char*)&size, sizeof(size));
+         buffer.append(text);
+      }
+
+      changed.Clear();
+      changedOrder.clear();
+
+      journalSize += buffer.size();
+
+      writeJob = JobSystem::Get().ScheduleBackground([path = journalPath, buffer = std::move(buffer)] {
+         OPTICK_EVENT("Scene Journal Write");
+
+         std::ofstream file{ path, std::ios::binary | std::ios::app };
+         file.write(buffer.data(), buffer.size());
+         if (!file) {
+            WARN("Cant write scene journal '{}'", path);
+         }
+      }, std::span{ &writeJob, 1 });
+   }
+
+   void SceneJournal::Compact() {
+      OPTICK_EVENT("Scene Journal Compact");
+
+      // journal must end with current state of changed entities, in case of crash before it is truncated
+      Flush();
+      if (writeJob) {
+         JobSystem::Get().Wait(writeJob);
+      }
+
+      // snapshot is replaced only when it is completely written
+      auto tmpPath = fs::path{ snapshotPath }.replace_extension(".tmp.scn").string();
+      SceneSerialize(tmpPath, scene);
+
+      std::error_code ec;
+      fs::rename(tmpPath, snapshotPath, ec);
+      if (ec) {
+         WARN("Cant write scene snapshot '{}'", snapshotPath);
+         return;
+      }
+
+      auto tmpBinaryPath = GetBinaryPath(tmpPath);
+      if (fs::exists(tmpBinaryPath)) {
+         fs::rename(tmpBinaryPath, GetBinaryPath(snapshotPath), ec);
+      } else {
+         fs::remove(GetBinaryPath(snapshotPath), ec);
+      }
+
+      std::ofstream{ journalPath, std::ios::binary | std::ios::trunc };
+      journalSize = 0;
+   }
+
+   void SceneJournal::Reset() {
+      changed.Clear();
+      changedOrder.clear();
+
+      if (writeJob) {
+         JobSystem::Get().Wait(writeJob);
+      }
+
+      RemoveFiles();
+      journalSize = 0;
+      flushTime = 0;
+   }
+
+   void SceneJournal::OnComponentEvent(entt::entity entity, TypeID typeID, ComponentEvent event) {
+      // while entity is destroyed its components may be removed after uuid, entity is already marked by uuid removal
+      const auto* uuid = Entity{ entity, &scene }.TryGet<UUIDComponent>();
+      if (!uuid) {
+         return;
+      }
+
+      auto& change = GetChange(uuid->uuid);
+      if (typeID == GetTypeID<UUIDComponent>()) {
+         // removal is recorded as destroy, entity is missing on flush
+         change.created |= event == ComponentEvent::Add;
+      } else if (typeID == GetTypeID<TagComponent>() || typeID == GetTypeID<SceneTransformComponent>()) {
+         change.state = true;
+      } else {
+         change.components.emplace_back(typeID);
+      }
+   }
+
+   void SceneJournal::RemoveFiles() {
+      std::error_code ec;
+      fs::remove(journalPath, ec);
+      fs::remove(snapshotPath, ec);
+      fs::remove(GetBinaryPath(snapshotPath), ec);
+   }
+
+   string SceneJournal::RecoveryScenePath(std::string_view scenePath) {
+      auto snapshotPath = GetSnapshotPath(scenePath);
+      return fs::exists(snapshotPath) ? snapshotPath : string{ scenePath };
+   }
+
+   static uint64 RecordUuid(const Deserializer& deser) {
+      if (auto destroyed = deser["destroyed"]) {
+         return destroyed.As<uint64>();
+      }
+      if (auto created = deser["created"]) {
+         return created["uuid"].As<uint64>();
+      }
+      return deser["uuid"].As<uint64>();
+   }
+
+   static bool IsWholeRecord(const Deserializer& deser) {
+      return deser["destroyed"] || deser["created"];
+   }
+
+   // entity of whole record is recreated, so components which are not in record are removed.
+   // All entities are recreated before any record is deserialized, so entity references between records are resolved
+   static void RecreateEntity(Scene& scene, const Deserializer& deser) {
+      uint64 uuid = RecordUuid(deser);
+
+      bool root = false;
+      if (Entity entity = scene.GetEntity(uuid)) {
+         root = entity == scene.GetRootEntity();
+         scene.DestroyImmediate(entity, false);
+      }
+
+      if (deser["destroyed"]) {
+         return;
+      }
+
+      Entity entity = scene.CreateWithUUID(uuid, Entity{});
+      entity.Add<DisableMarker>();
+
+      if (root) {
+         scene.SetRootEntity(entity);
+      }
+   }
+
+   static void ReplayCreated(Scene& scene, const Deserializer& deser) {
+      EntityDeserialize(deser, scene);
+
+      // children are restored by record, parent is restored here. Children record of parent follows and fixes order
+      if (auto parentUuid = deser["SceneTransformComponent"]["parent"]) {
+         if (Entity parent = scene.GetEntity(parentUuid.As<uint64>())) {
+            scene.GetEntity(deser["uuid"].As<uint64>()).GetTransform().SetParent(parent, -1, true);
+         }
+      }
+   }
+
+   static void ReplayPatch(Scene& scene, const Deserializer& deser) {
+      Entity entity = scene.GetEntity(deser["uuid"].As<uint64>());
+      if (!entity) {
+         return;
+      }
+
+      const auto& typer = Typer::Get();
+
+      Deserializer sceneDeser = deser;
+      sceneDeser.scene = &scene;
+
+      if (auto tag = deser["tag"]) {
+         entity.SetName(tag.As<string>());
+
+         auto& trans = entity.GetTransform();
+         trans.SetLocalTransform(deser.Deser<vec3>("position"), deser.Deser<quat>("rotation"), deser.Deser<vec3>("scale"));
+
+         // own state, children have their own records
+         if (deser["enabled"].As<bool>()) {
+            scene.EntityEnable(entity, false);
+         } else {
+            scene.EntityDisable(entity, false);
+         }
+      }
+
+      if (auto components = sceneDeser["components"]) {
+         for (TextNode node : components.node) {
+            const auto* ci = typer.FindComponent(node.Key());
+            if (!ci) {
+               continue;
+            }
+            auto* ptr = (byte*)ci->getOrAdd(entity);
+            typer.Deserialize(sceneDeser.Child(node), {}, ci->typeID, ptr);
+            ci->patch(entity);
+         }
+      }
+
+      if (auto removed = deser["removed"]) {
+         for (TextNode node : removed.node) {
+            const auto* ci = typer.FindComponent(node.as<string>());
+            if (ci && ci->has(entity)) {
+               ci->remove(entity);
+            }
+         }
+      }
+
+      // children are moved to the end in record order, so children order is the same as on record
+      if (auto children = deser["children"]) {
+         for (TextNode node : children.node) {
+            if (Entity child = scene.GetEntity(node.as<uint64>())) {
+               child.GetTransform().SetParent(entity, -1, true);
+            }
+         }
+      }
+   }
+
+   bool SceneJournal::Recover(Scene& scene, std::string_view scenePath) {
+      bool recovered = fs::exists(GetSnapshotPath(scenePath));
+
+      auto journalPath = GetJournalPath(scenePath);
+      std::ifstream file{ journalPath, std::ios::binary };
+      if (!file) {
+         return recovered;
+      }
+
+      string data{ std::istreambuf_iterator<char>{ file }, {} };
+
+      std::vector<Deserializer> records;
+      size_t pos = 0;
+      while (pos + sizeof(uint) <= data.size()) {
+         uint size;
+         std::memcpy(&size, data.data() + pos, sizeof(uint));
+         pos += sizeof(uint);
+
+         if (pos + size > data.size()) {
+            WARN("Scene journal '{}' ends with torn record", journalPath);
+            break;
+         }
+
+         records.emplace_back(Deserializer::FromStr(string_view{ data.data() + pos, size }));
+         pos += size;
+      }
+
+      // created or destroyed record is whole state of entity, records of entity before it are outdated
+      std::unordered_map<uint64, size_t> lastWholeRecords;
+      for (size_t i = 0; i < records.size(); ++i) {
+         if (IsWholeRecord(records[i])) {
+            lastWholeRecords[RecordUuid(records[i])] = i;
+         }
+      }
+
+      auto isOutdated = [&](size_t i) {
+         auto it = lastWholeRecords.find(RecordUuid(records[i]));
+         return it != lastWholeRecords.end() && i < it->second;
+      };
+
+      for (const auto& [_, i] : lastWholeRecords) {
+         RecreateEntity(scene, records[i]);
+      }
+
+      // patches are applied in order of writing
+      for (size_t i = 0; i < records.size(); ++i) {
+         if (isOutdated(i) || records[i]["destroyed"]) {
+            continue;
+         }
+
+         if (auto created = records[i]["created"]) {
+            ReplayCreated(scene, created);
+         } else {
+            ReplayPatch(scene, records[i]);
+         }
+      }
+
+      scene.ProcessDelayedEnable();
+
+      int nRecords = (int)records.size();
+
+      if (nRecords > 0) {
+         INFO("Recovered {} records of scene journal '{}'", nRecords, journalPath);
+      }
+
+      return recovered || nRecords > 0;
+   }
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core/Core.h"
+#include "core/JobSystem.h"
+#include "core/UUID.h"
+#include "core/UUIDMap.h"
+#include "typer/Typer.h"
+
+namespace pbe {
+
+   class Scene;
+
+   // Append-only journal of scene edits for autosave and crash recovery.
+   // Changes are collected by component signals and Mark* calls. On flush only changed parts are serialized
+   // on main thread: component values, own state of entity, children order of parent, whole created entity or
+   // destroy. Records are appended to '<scene>.journal' by background job.
+   // When journal becomes big it is compacted into full snapshot '<scene>.autosave.scn'.
+   // Files are removed on Reset (scene is saved) and on destruction, so they are left only by crash
+   class CORE_API SceneJournal : ComponentListener {
+   public:
+      SceneJournal(Scene& scene, std::string_view scenePath);
+      ~SceneJournal() override;
+
+      NON_COPYABLE(SceneJournal);
+
+      // for changes not visible by component signals: name, enabled, local transform
+      void MarkChanged(UUID uuid);
+      // parent or child index of entity is changed, children order of its parent is recorded
+      void MarkParentChanged(UUID uuid);
+
+      // call every frame
+      void Update(float dt);
+
+      void Flush();
+      // write snapshot of scene and truncate journal
+      void Compact();
+      // scene is saved, remove journal and snapshot
+      void Reset();
+
+      // scene to load instead of scenePath: autosave snapshot left by crash or scenePath itself
+      static string RecoveryScenePath(std::string_view scenePath);
+      // replay journal left by crash on scene loaded from RecoveryScenePath. False if there was nothing to recover
+      static bool Recover(Scene& scene, std::string_view scenePath);
+
+   private:
+      Scene& scene;
+      string journalPath;
+      string snapshotPath;
+
+      struct EntityChange {
+         bool queued = false; // in changedOrder
+         bool created = false; // whole entity is recorded
+         bool state = false; // name, enabled, local transform
+         bool parent = false; // parent or child index, children order of current parent is recorded on flush
+         bool children = false; // children order
+         std::vector<TypeID> components; // changed or removed
+      };
+
+      UUIDMap<EntityChange> changed;
+      std::vector<UUID> changedOrder;
+
+      float flushTime = 0;
+      size_t journalSize = 0; // bytes since last compaction
+      JobHandle writeJob; // appends are chained
+
+      EntityChange& GetChange(UUID uuid);
+
+      void OnComponentEvent(entt::entity entity, TypeID typeID, ComponentEvent event) override;
+      void RemoveFiles();
+   };
+
+}
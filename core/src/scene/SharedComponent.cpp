@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "SharedComponent.h"
+
+#include "core/Assert.h"
+#include "typer/Typer.h"
+
+
+namespace pbe {
+
+   template <class T>
+   static void HashCombine(uint64& s, const T& v) {
+      std::hash<T> h;
+      s ^= h(v) + 0x9e3779b9 + (s << 6) + (s >> 2);
+   }
+
+   SharedPayloadTable::SharedPayloadTable(TypeID typeID) : typeID(typeID) {
+      layout = std::make_unique<BinaryLayout>();
+      bool valid = BuildBinaryLayout(Typer::Get().GetTypeInfo(typeID), 0, *layout);
+      ASSERT_MESSAGE(valid, "Shared component must have binary layout");
+   }
+
+   SharedPayloadTable::~SharedPayloadTable() = default;
+
+   const byte* SharedPayloadTable::GetPayload(SharedHandle handle) const {
+      ASSERT(handle < PayloadsCount());
+      return PayloadPtr(handle);
+   }
+
+   SharedHandle SharedPayloadTable::Add(const byte* value) {
+      uint64 hash = Hash(value);
+
+      auto [it, end] = handlesByHash.equal_range(hash);
+      for (; it != end; ++it) {
+         if (Equal(PayloadPtr(it->second), value)) {
+            return it->second;
+         }
+      }
+
+      SharedHandle handle = payloadsCount++;
+      AddPayload(value);
+      handlesByHash.emplace(hash, handle);
+
+      return handle;
+   }
+
+   uint64 SharedPayloadTable::Hash(const byte* value) const {
+      uint64 hash = 0;
+      for (const auto& leaf : layout->leaves) {
+         const byte* data = value + leaf.offset;
+         if (leaf.kind == BinaryKind::String) {
+            HashCombine(hash, *(const string*)data);
+         } else {
+            HashCombine(hash, std::string_view{ (const char*)data, leaf.size });
+         }
+      }
+      return hash;
+   }
+
+   bool SharedPayloadTable::Equal(const byte* a, const byte* b) const {
+      for (const auto& leaf : layout->leaves) {
+         const byte* aData = a + leaf.offset;
+         const byte* bData = b + leaf.offset;
+         if (leaf.kind == BinaryKind::String) {
+            if (*(const string*)aData != *(const string*)bData) {
+               return false;
+            }
+         } else if (std::memcmp(aData, bData, leaf.size) != 0) {
+            return false;
+         }
+      }
+      return true;
+   }
+
+}
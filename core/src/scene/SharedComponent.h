@@ -0,0 +1,85 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+
+#include "core/Core.h"
+#include "core/Ref.h"
+#include "core/Type.h"
+#include "math/Types.h"
+
+namespace pbe {
+
+   struct BinaryLayout;
+
+   // component is shared if it declares 'static constexpr bool SHARED = true'.
+   // Scene file stores identical values of it (e.g. material of thousands of cubes) once, entities reference them
+   template<typename T>
+   concept Component_Shared = requires { requires T::SHARED; };
+
+   using SharedHandle = uint;
+   constexpr SharedHandle InvalidSharedHandle = UINT32_MAX;
+
+   // Deduplicated values of one component type, used while 'shared' section of scene file is written or read.
+   // Values are compared by Typer binary layout, so padding doesn't matter. Scene doesn't keep it,
+   // entities own their values
+   class CORE_API SharedPayloadTable {
+   public:
+      SharedPayloadTable(TypeID typeID);
+      virtual ~SharedPayloadTable();
+
+      TypeID GetTypeID() const { return typeID; }
+
+      const byte* GetPayload(SharedHandle handle) const;
+      // handles are [0, PayloadsCount), in order of addition
+      uint PayloadsCount() const { return payloadsCount; }
+
+      // handle of payload equal to value
+      SharedHandle Add(const byte* value);
+      // decode(byte*) fills default constructed value
+      virtual SharedHandle Add(const std::function<void(byte*)>& decode) = 0;
+
+   protected:
+      virtual const byte* PayloadPtr(SharedHandle handle) const = 0;
+      virtual void AddPayload(const byte* value) = 0;
+
+   private:
+      TypeID typeID;
+      Own<BinaryLayout> layout;
+
+      uint payloadsCount = 0;
+      std::unordered_multimap<uint64, SharedHandle> handlesByHash;
+
+      uint64 Hash(const byte* value) const;
+      bool Equal(const byte* a, const byte* b) const;
+   };
+
+   template<typename T>
+   class SharedPayloadTableT : public SharedPayloadTable {
+   public:
+      SharedPayloadTableT() : SharedPayloadTable(pbe::GetTypeID<T>()) {}
+
+      const T& Get(SharedHandle handle) const { return *(const T*)GetPayload(handle); }
+
+      using SharedPayloadTable::Add;
+
+      SharedHandle Add(const std::function<void(byte*)>& decode) override {
+         T value{};
+         decode((byte*)&value);
+         return Add((const byte*)&value);
+      }
+
+   protected:
+      const byte* PayloadPtr(SharedHandle handle) const override {
+         return (const byte*)&payloads[handle];
+      }
+
+      void AddPayload(const byte* value) override {
+         payloads.emplace_back(*(const T*)value);
+      }
+
+   private:
+      std::deque<T> payloads; // stable addresses
+   };
+
+}
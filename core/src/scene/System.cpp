@@ -4,4 +4,30 @@
 
 namespace pbe {
 
+   bool SystemAccess::Conflicts(const SystemAccess& other) const {
+      if (exclusive || other.exclusive) {
+         return true;
+      }
+
+      for (const auto& a : components) {
+         for (const auto& b : other.components) {
+            if (a.typeID == b.typeID && (a.write || b.write)) {
+               return true;
+            }
+         }
+      }
+
+      return false;
+   }
+
+   bool SystemAccess::Writes(entt::id_type typeID) const {
+      return exclusive || std::ranges::any_of(components, [&](const ComponentAccess& c) { return c.typeID == typeID && c.write; });
+   }
+
+   void SystemAccess::AssureStorages(entt::registry& registry) const {
+      for (const auto& component : components) {
+         component.assureStorage(registry);
+      }
+   }
+
 }
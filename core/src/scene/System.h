@@ -10,14 +10,60 @@ namespace pbe {
 
    class Scene;
 
+   // components which are read/written during OnUpdate. systems with non conflicting access are updated in parallel.
+   // exclusive (default) - system runs alone on main thread, it is allowed to create/destroy entities and add/remove components.
+   // non exclusive system must touch only declared components and must not change scene structure.
+   struct CORE_API SystemAccess {
+      struct ComponentAccess {
+         entt::id_type typeID;
+         bool write = false;
+         void(*assureStorage)(entt::registry&) = nullptr;
+      };
+
+      bool exclusive = true;
+      std::vector<ComponentAccess> components;
+
+      template<typename... Components>
+      SystemAccess& Read() {
+         exclusive = false;
+         (Add<Components>(false), ...);
+         return *this;
+      }
+
+      template<typename... Components>
+      SystemAccess& Write() {
+         exclusive = false;
+         (Add<Components>(true), ...);
+         return *this;
+      }
+
+      bool Conflicts(const SystemAccess& other) const;
+      // exclusive system may write any component
+      bool Writes(entt::id_type typeID) const;
+
+      // storages must exist before parallel update, registry can't create them concurrently
+      void AssureStorages(entt::registry& registry) const;
+
+   private:
+      template<typename Component>
+      void Add(bool write) {
+         components.emplace_back(ComponentAccess{ entt::type_hash<Component>::value(), write,
+            [](entt::registry& registry) { registry.storage<Component>(); } });
+      }
+   };
+
    class CORE_API System {
    public:
       virtual ~System() = default;
 
+      virtual const char* GetName() const { return "System"; }
+      virtual SystemAccess GetAccess() const { return {}; }
+
       virtual void OnSetEventHandlers(entt::registry& registry) {}
 
-      virtual void OnEntityEnable() {}
-      virtual void OnEntityDisable() {}
+      // entities which become enabled/disabled on this sync, called only if there are changes
+      virtual void OnEntityEnable(std::span<const entt::entity> entities) {}
+      virtual void OnEntityDisable(std::span<const entt::entity> entities) {}
 
       virtual void OnUpdate(float dt) {}
 
@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "SystemScheduler.h"
+
+#include "Scene.h"
+#include "core/JobSystem.h"
+#include "core/Profiler.h"
+
+
+namespace pbe {
+
+   void SystemScheduler::Clear() {
+      nodes.clear();
+   }
+
+   void SystemScheduler::Add(std::string_view name, SystemAccess access, std::function<void(float)> update) {
+      Node node{ std::string{ name }, std::move(access), std::move(update) };
+
+      for (int i = 0; i < (int)nodes.size(); ++i) {
+         if (node.access.Conflicts(nodes[i].access)) {
+            node.dependencies.emplace_back(i);
+         }
+      }
+
+      nodes.emplace_back(std::move(node));
+   }
+
+   void SystemScheduler::Update(entt::registry& registry, float dt) {
+      PROFILE_CPU("Systems update");
+
+      // views exclude disabled entities
+      registry.storage<DisableMarker>();
+      for (const auto& node : nodes) {
+         node.access.AssureStorages(registry);
+      }
+
+      auto& jobSystem = JobSystem::Get();
+
+      std::vector<JobHandle> handles;
+      handles.reserve(nodes.size());
+      std::vector<JobHandle> dependencies;
+
+      for (auto& node : nodes) {
+         dependencies.clear();
+         for (int iDependency : node.dependencies) {
+            dependencies.emplace_back(handles[iDependency]);
+         }
+
+         auto job = [&node, dt] {
+            OPTICK_EVENT_DYNAMIC(node.name.c_str());
+            CpuTimer timer;
+            node.update(dt);
+            node.timeMs = timer.ElapsedMs();
+         };
+
+         // exclusive systems may change scene structure, run them on main thread
+         auto affinity = node.access.exclusive ? JobAffinity::MainThread : JobAffinity::Any;
+         handles.emplace_back(jobSystem.Schedule(std::move(job), dependencies, affinity));
+      }
+
+      jobSystem.WaitAll(handles);
+   }
+
+}
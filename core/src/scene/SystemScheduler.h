@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/Core.h"
+#include "System.h"
+
+
+namespace pbe {
+
+   class Scene;
+
+   // Runs systems and scripts OnUpdate. Each system depends on all previous systems with conflicting access,
+   // independent systems are executed by job system in parallel.
+   class CORE_API SystemScheduler {
+   public:
+      struct Node {
+         std::string name;
+         SystemAccess access;
+         std::function<void(float)> update;
+
+         std::vector<int> dependencies; // indices of previous nodes
+
+         float timeMs = 0; // time of the last update
+      };
+
+      void Clear();
+      void Add(std::string_view name, SystemAccess access, std::function<void(float)> update);
+
+      void Update(entt::registry& registry, float dt);
+
+      const std::vector<Node>& GetNodes() const { return nodes; }
+
+   private:
+      std::vector<Node> nodes;
+   };
+
+}
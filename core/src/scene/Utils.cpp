@@ -14,7 +14,7 @@ namespace pbe {
    Entity CreateEmpty(Scene& scene, string_view namePrefix, Entity parent, const vec3& pos) {
       // todo: find appropriate name
       auto entity = scene.Create(parent, namePrefix);
-      entity.Get<SceneTransformComponent>().position = pos;
+      entity.Get<SceneTransformComponent>().SetLocalPosition(pos);
       return entity;
    }
 
@@ -22,11 +22,11 @@ namespace pbe {
       auto entity = CreateEmpty(scene, desc.namePrefix, desc.parent, desc.pos);
 
       auto& trans = entity.Get<SceneTransformComponent>();
-      trans.scale = desc.scale;
-      trans.rotation = desc.rotation;
+      trans.SetLocalScale(desc.scale);
+      trans.SetLocalRotation(desc.rotation);
 
       entity.Add<GeometryComponent>();
-      entity.Add<MaterialComponent>().baseColor = desc.color;
+      entity.Add<MaterialComponent>(MaterialComponent{ .baseColor = desc.color });
 
       // todo:
       RigidBodyComponent _rb{};
@@ -38,7 +38,7 @@ namespace pbe {
 
    Entity CreateDirectLight(Scene& scene, string_view namePrefix, const vec3& pos) {
       auto entity = CreateEmpty(scene, namePrefix, {}, pos);
-      entity.Get<SceneTransformComponent>().rotation = quat{ vec3{PIHalf * 0.5, PIHalf * 0.5, 0 } };
+      entity.Get<SceneTransformComponent>().SetLocalRotation(quat{ vec3{PIHalf * 0.5, PIHalf * 0.5, 0 } });
       entity.Add<DirectLightComponent>();
       return entity;
    }
@@ -163,12 +163,13 @@ namespace pbe {
                Entity e{ _e, &scene };
                auto& geom = e.GetOrAdd<GeometryComponent>();
                geom.type = GeomType::Box;
+               e.MarkComponentUpdated<GeometryComponent>();
             }
          }
 
          if (ImGui::MenuItem("Create wall")) {
             Entity root = scene.Create("Wall");
-            root.GetTransform().position = spawnPosHint;
+            root.GetTransform().SetLocalPosition(spawnPosHint);
 
             int size = 10;
             for (int y = 0; y < size; ++y) {
@@ -185,7 +186,7 @@ namespace pbe {
 
          if (ImGui::MenuItem("Create stack tri")) {
             Entity root = scene.Create("Stack tri");
-            root.GetTransform().position = spawnPosHint;
+            root.GetTransform().SetLocalPosition(spawnPosHint);
 
             int size = 10;
             for (int y = 0; y < size; ++y) {
@@ -203,7 +204,7 @@ namespace pbe {
 
          if (ImGui::MenuItem("Create stack")) {
             Entity root = scene.Create("Stack");
-            root.GetTransform().position = spawnPosHint;
+            root.GetTransform().SetLocalPosition(spawnPosHint);
 
             int size = 10;
             for (int i = 0; i < size; ++i) {
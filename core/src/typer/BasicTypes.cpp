@@ -5,23 +5,101 @@
 #include "math/Types.h"
 #include "scene/Component.h"
 #include "scene/Entity.h"
-#include "typer/Serialize.h"
+#include "typer/StaticSerialize.h"
 
 
 namespace pbe {
 
-   static void SerVec3(Serializer& ser, const vec3& v) {
-      ser.out << YAML::Flow << YAML::BeginSeq << v.x << v.y << v.z << YAML::EndSeq;
+   template<int N>
+   static void SerFloats(Serializer& ser, const float* v) {
+      SERIALIZER_FLOW_SEQ(ser);
+      for (int i = 0; i < N; ++i) {
+         ser.out.Value(v[i]);
+      }
+   }
+
+   void SerializeValue(Serializer& ser, const vec2& v) {
+      SerFloats<2>(ser, &v.x);
+   }
+
+   void SerializeValue(Serializer& ser, const vec3& v) {
+      SerFloats<3>(ser, &v.x);
+   }
+
+   void SerializeValue(Serializer& ser, const vec4& v) {
+      SerFloats<4>(ser, &v.x);
+   }
+
+   void SerializeValue(Serializer& ser, const quat& v) {
+      SerializeValue(ser, glm::degrees(glm::eulerAngles(v)));
+   }
+
+   void SerializeValue(Serializer& ser, const StringID& v) {
+      ser.out.Value(v.CStr());
+   }
+
+   void SerializeValue(Serializer& ser, const Entity& e) {
+      if (e.Valid()) {
+         ser.out.Value((pbe::uint64)e.GetUUID());
+      } else {
+         ser.out.Value((pbe::uint64)entt::null);
+      }
+   }
+
+   template<int N>
+   static bool DeserFloats(const Deserializer& deser, float* v) {
+      if (!deser.node.IsSequence() || deser.node.size() != N) {
+         return false;
+      }
+
+      bool success = true;
+      int i = 0;
+      for (auto item : deser.node) {
+         success &= item.TryAs(v[i++]);
+      }
+      return success;
+   }
+
+   bool DeserializeValue(const Deserializer& deser, vec2& v) {
+      return DeserFloats<2>(deser, &v.x);
+   }
+
+   bool DeserializeValue(const Deserializer& deser, vec3& v) {
+      return DeserFloats<3>(deser, &v.x);
    }
 
-   static bool DeserVec3(const Deserializer& deser, vec3& v) {
-      if (!deser.node.IsSequence() || deser.node.size() != 3) {
+   bool DeserializeValue(const Deserializer& deser, vec4& v) {
+      return DeserFloats<4>(deser, &v.x);
+   }
+
+   bool DeserializeValue(const Deserializer& deser, quat& v) {
+      vec3 angles;
+      if (!DeserializeValue(deser, angles)) {
          return false;
       }
+      v = glm::quat{ glm::radians(angles) };
+      return true;
+   }
+
+   bool DeserializeValue(const Deserializer& deser, StringID& v) {
+      string str;
+      if (!deser.node.TryAs(str)) {
+         return false;
+      }
+      v = StringID{ str };
+      return true;
+   }
+
+   bool DeserializeValue(const Deserializer& deser, Entity& e) {
+      pbe::UUID entityUUID = deser.node.as<pbe::uint64>();
+      if ((pbe::uint64)entityUUID != (pbe::uint64)entt::null) {
+         if (!deser.scene) {
+            WARN("Entity reference is deserialized without scene");
+            return false;
+         }
+         e = deser.scene->GetEntity(entityUUID);
+      }
 
-      v.x = deser.node[0].as<float>();
-      v.y = deser.node[1].as<float>();
-      v.z = deser.node[2].as<float>();
       return true;
    }
 
@@ -32,8 +110,12 @@ namespace pbe {
    ti.typeSizeOf = sizeof(Type)
 
 #define DEFAULT_SER_DESER(Type) \
-   ti.serialize = [](Serializer& ser, const byte* value) { ser.out << *(Type*)value; }; \
-   ti.deserialize = [](const Deserializer& deser, byte* value) { return YAML::convert<Type>::decode(deser.node, *(Type*)value); };
+   ti.serialize = [](Serializer& ser, const byte* value) { ser.out.Value(*(Type*)value); }; \
+   ti.deserialize = [](const Deserializer& deser, byte* value) { return deser.node.TryAs(*(Type*)value); };
+
+#define VALUE_SER_DESER(Type) \
+   ti.serialize = [](Serializer& ser, const byte* value) { SerializeValue(ser, *(const Type*)value); }; \
+   ti.deserialize = [](const Deserializer& deser, byte* value) { return DeserializeValue(deser, *(Type*)value); };
 
 #define END_DECL_TYPE() \
    typer.RegisterType(ti.typeID, std::move(ti))
@@ -42,21 +124,25 @@ namespace pbe {
       TypeInfo ti;
 
       START_DECL_TYPE(bool);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) { return ImGui::Checkbox(name, (bool*)value); };
       DEFAULT_SER_DESER(bool);
       END_DECL_TYPE();
 
       START_DECL_TYPE(float);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) { return ImGui::InputFloat(name, (float*)value); };
       DEFAULT_SER_DESER(float);
       END_DECL_TYPE();
 
       START_DECL_TYPE(int);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) { return ImGui::InputInt(name, (int*)value); };
       DEFAULT_SER_DESER(int);
       END_DECL_TYPE();
 
       START_DECL_TYPE(int64);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) {
          // todo:
          const char* format = "%d";
@@ -67,6 +153,7 @@ namespace pbe {
       END_DECL_TYPE();
 
       START_DECL_TYPE(uint64);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) {
          const char* format = "%d";
          return ImGui::InputScalar(name, ImGuiDataType_U64, value, NULL, NULL, format, 0);
@@ -75,60 +162,38 @@ namespace pbe {
       END_DECL_TYPE();
 
       START_DECL_TYPE(string);
+      ti.binaryKind = BinaryKind::String;
       // todo:
-      ti.ui = [](const char* name, byte* value) { ImGui::Text(((string*)value)->data()); return false; };
+      ti.ui = [](const char* name, byte* value) { ImGui::TextUnformatted(((string*)value)->data()); return false; };
       DEFAULT_SER_DESER(string);
       END_DECL_TYPE();
 
+      START_DECL_TYPE(StringID);
+      ti.binaryKind = BinaryKind::StringID;
+      ti.ui = [](const char* name, byte* value) { ImGui::TextUnformatted(((StringID*)value)->CStr()); return false; };
+      VALUE_SER_DESER(StringID);
+      END_DECL_TYPE();
+
       START_DECL_TYPE(vec2);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) { return ImGui::InputFloat2(name, (float*)value); };
-      ti.serialize = [](Serializer& ser, const byte* value){
-         const auto& v = *(vec2*)value;
-         ser.out << YAML::Flow << YAML::BeginSeq << v.x << v.y << YAML::EndSeq;
-      };
-      ti.deserialize = [](const Deserializer& deser, byte* value) {
-         if (!deser.node.IsSequence() || deser.node.size() != 2) {
-            return false;
-         }
-
-         auto& v = *(vec2*)value;
-         v.x = deser.node[0].as<float>();
-         v.y = deser.node[1].as<float>();
-         return true;
-      };
+      VALUE_SER_DESER(vec2);
       END_DECL_TYPE();
 
       START_DECL_TYPE(vec3);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) { return ImGui::InputFloat3(name, (float*)value); };
-      ti.serialize = [](Serializer& ser, const byte* value) {
-         SerVec3(ser, *(vec3*)value);
-      };
-      ti.deserialize = [](const Deserializer& deser, byte* value) {
-         return DeserVec3(deser, *(vec3*)value);
-      };
+      VALUE_SER_DESER(vec3);
       END_DECL_TYPE();
 
       START_DECL_TYPE(vec4);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) { return ImGui::ColorEdit4(name, (float*)value); };
-      ti.serialize = [](Serializer& ser, const byte* value) {
-         const auto& v = *(vec4*)value;
-         ser.out << YAML::Flow << YAML::BeginSeq << v.x << v.y << v.z << v.w << YAML::EndSeq;
-      };
-      ti.deserialize = [](const Deserializer& deser, byte* value) {
-         if (!deser.node.IsSequence() || deser.node.size() != 4) {
-            return false;
-         }
-
-         auto& v = *(vec4*)value;
-         v.x = deser.node[0].as<float>();
-         v.y = deser.node[1].as<float>();
-         v.z = deser.node[2].as<float>();
-         v.w = deser.node[3].as<float>();
-         return true;
-      };
+      VALUE_SER_DESER(vec4);
       END_DECL_TYPE();
 
       START_DECL_TYPE(quat);
+      ti.binaryKind = BinaryKind::Raw;
       ti.ui = [](const char* name, byte* value) {
          auto angles = glm::degrees(glm::eulerAngles(*(quat*)value));
          if (ImGui::InputFloat3(name, &angles.x)) {
@@ -137,26 +202,16 @@ namespace pbe {
          }
          return false;
       };
-      ti.serialize = [](Serializer& ser, const byte* value) {
-         auto angles = glm::degrees(glm::eulerAngles(*(quat*)value));
-         SerVec3(ser, angles);
-      };
-      ti.deserialize = [](const Deserializer& deser, byte* value) {
-         vec3 angles;
-         if (!DeserVec3(deser, angles)) {
-            return false;
-         }
-         *(quat*)value = glm::quat{ glm::radians(angles) };
-         return true;
-      };
+      VALUE_SER_DESER(quat);
       END_DECL_TYPE();
 
       // todo: it is not basic type
       START_DECL_TYPE(Entity);
+      ti.binaryKind = BinaryKind::Entity;
       ti.ui = [](const char* name, byte* value) {
          Entity* e = (Entity*)value;
 
-         ImGui::Text(name);
+         ImGui::TextUnformatted(name);
          ImGui::SameLine();
 
          const char* entityName = e->Valid() ? e->GetName() : "None";
@@ -171,24 +226,7 @@ namespace pbe {
 
          return false;
       };
-      ti.serialize = [](Serializer& ser, const byte* value) {
-         const auto& e = *(Entity*)value;
-
-         if (e.Valid()) {
-            ser.out << (pbe::uint64)e.GetUUID();
-         } else {
-            ser.out << (pbe::uint64)entt::null;
-         }
-      };
-      ti.deserialize = [](const Deserializer& deser, byte* value) {
-         pbe::UUID entityUUID = deser.node.as<pbe::uint64>();
-         if ((pbe::uint64)entityUUID != (pbe::uint64)entt::null) {
-            pbe::Scene* scene = pbe::Scene::GetCurrentDeserializedScene();
-            *(Entity*)value = scene->GetEntity(entityUUID);
-         }
-
-         return true;
-      };
+      VALUE_SER_DESER(Entity);
       END_DECL_TYPE();
    }
 
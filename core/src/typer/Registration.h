@@ -1,20 +1,14 @@
 #pragma once
 
+#include "StaticSerialize.h"
 #include "Typer.h"
+#include "core/JobSystem.h"
+#include "scene/Entity.h"
+#include "scene/SharedComponent.h"
 
 
 namespace pbe {
 
-   template<typename T>
-   concept HasSerialize = requires(T a, Serializer & ser) {
-      { a.Serialize(ser) };
-   };
-
-   template<typename T>
-   concept HasDeserialize = requires(T a, const Deserializer & deser) {
-      { a.Deserialize(deser) } -> std::same_as<bool>;
-   };
-
    template<typename T>
    concept HasUI = requires(T a) {
       { a.UI() } -> std::same_as<bool>;
@@ -35,6 +29,31 @@ namespace pbe {
       { a.OnChanged() };
    };
 
+   template<typename T>
+   concept HasUpdateBatch = requires(std::span<T> scripts, float dt) {
+      { T::UpdateBatch(scripts, dt) };
+   };
+
+   // 'static constexpr bool ParallelUpdate = true' - instances may be updated from different threads simultaneously
+   template<typename T>
+   concept HasParallelUpdate = requires() {
+      requires T::ParallelUpdate;
+   };
+
+   template<typename T>
+   concept HasAccess = requires() {
+      { T::GetAccess() } -> std::same_as<SystemAccess>;
+   };
+
+   template<typename T>
+   SystemAccess GetAccess() {
+      if constexpr (HasAccess<T>) {
+         return T::GetAccess();
+      } else {
+         return {};
+      }
+   }
+
    template<typename T>
    auto GetSerialize() {
       if constexpr (HasSerialize<T>) {
@@ -89,6 +108,88 @@ namespace pbe {
       }
    }
 
+   template<typename T>
+   TypeInfo MakeStructTypeInfo(const char* name) {
+      TypeInfo ti;
+      ti.name = name;
+      ti.typeID = GetTypeID<T>();
+      ti.typeSizeOf = sizeof(T);
+
+      ti.serialize = GetSerialize<T>();
+      ti.deserialize = GetDeserialize<T>();
+      ti.ui = GetUI<T>();
+
+      ti.serializeStatic = [](Serializer& ser, const byte* value) { StaticSerializeValue(ser, *(const T*)value); };
+      ti.deserializeStatic = [](const Deserializer& deser, byte* value) { return StaticDeserializeValue(deser, *(T*)value); };
+
+      TypeInfoBuilder builder{ ti };
+      StructFields<T>::Visit(builder);
+
+      return ti;
+   }
+
+   // update enabled scripts by contiguous chunks of storage, without std::function and virtual call per instance
+   // note: scripts must not add components of its own type during update
+   template<typename T>
+   void UpdateScripts(entt::storage_for_t<T>& storage, const entt::sparse_set& disabled, float dt) {
+      static_assert(!entt::component_traits<T>::in_place_delete, "script storage must be packed");
+      constexpr int pageSize = (int)entt::component_traits<T>::page_size;
+
+      const auto* entities = storage.data();
+      auto pages = storage.raw();
+      int size = (int)storage.size();
+
+      std::vector<std::span<T>> chunks;
+
+      for (int begin = 0; begin < size; ) {
+         int pageEnd = std::min((begin / pageSize + 1) * pageSize, size);
+
+         int end = begin;
+         while (end < pageEnd && !disabled.contains(entities[end])) {
+            ++end;
+         }
+         if (end > begin) {
+            chunks.emplace_back(pages[begin / pageSize] + begin % pageSize, end - begin);
+         }
+
+         begin = end;
+         while (begin < pageEnd && disabled.contains(entities[begin])) {
+            ++begin;
+         }
+      }
+
+      auto updateChunk = [dt](std::span<T> chunk) {
+         if constexpr (HasUpdateBatch<T>) {
+            T::UpdateBatch(chunk, dt);
+         } else {
+            for (auto& script : chunk) {
+               script.T::OnUpdate(dt);
+            }
+         }
+      };
+
+      if constexpr (HasParallelUpdate<T>) {
+         auto& jobSystem = JobSystem::Get();
+
+         // pages are split to jobs by grain, a few jobs per thread to balance uneven scripts
+         constexpr int minGrain = 64;
+         int grain = std::max(minGrain, size / ((jobSystem.WorkersCount() + 1) * 4));
+
+         std::vector<std::span<T>> jobs;
+         for (auto chunk : chunks) {
+            for (size_t i = 0; i < chunk.size(); i += grain) {
+               jobs.emplace_back(chunk.subspan(i, std::min(chunk.size() - i, (size_t)grain)));
+            }
+         }
+
+         jobSystem.ParallelFor(0, (int)jobs.size(), 1, [&](int iJob) { updateChunk(jobs[iJob]); });
+      } else {
+         for (auto chunk : chunks) {
+            updateChunk(chunk);
+         }
+      }
+   }
+
 #define TYPE_REGISTER_GUARD_UNIQUE(unique) \
    static TypeRegisterGuard CONCAT(TypeRegisterGuard_, unique)
 
@@ -101,46 +202,62 @@ namespace pbe {
          ti.typeID = GetTypeID<type>(); \
          ti.typeSizeOf = sizeof(type);
 
+   // STRUCT_BEGIN body is 'StructFields<type>::Visit', macros inside it are calls of visitor 'v'
 #define TYPE_SERIALIZE(...) \
-         ti.serialize = __VA_ARGS__;
+         v.TypeSerialize(__VA_ARGS__);
 
 #define TYPE_DESERIALIZE(...) \
-         ti.deserialize = __VA_ARGS__;
+         v.TypeDeserialize(__VA_ARGS__);
 
 #define TYPE_UI(...) \
-         ti.ui = __VA_ARGS__;
+         v.TypeUI(__VA_ARGS__);
+
+   // increase with STRUCT_MIGRATION when change of fields can't be matched by names, e.g. type of field is changed
+#define STRUCT_VERSION(version) \
+         v.TypeVersion(version);
+
+   // void(const Deserializer& deser, CurrentType& value), for files with version less than toVersion.
+   // value is already deserialized by current fields, deser is value in file
+#define STRUCT_MIGRATION(toVersion, ...) \
+         v.template TypeMigration<CurrentType>(toVersion, __VA_ARGS__);
 
 #define STRUCT_BEGIN(type) \
-   TYPE_BEGIN(type) \
-      ti.serialize = GetSerialize<type>(); \
-      ti.deserialize = GetDeserialize<type>(); \
-      ti.ui = GetUI<type>(); \
+   template<> \
+   struct StructFields<type> { \
+      static constexpr bool defined = true; \
+      static constexpr const char* typeName = #type; \
+      using CurrentType = type; \
       \
-      TypeField f{};
+      template<typename Visitor> \
+      static void Visit(Visitor& v) {
 
    // for handle initialization like this 'TYPER_FIELD_UI2(UISliderFloat{ .min = -10, .max = 15 })'. problem with ','
 #define STRUCT_FIELD_UI(...) \
-      f.ui = __VA_ARGS__;
+         v.FieldUI(__VA_ARGS__);
 
 #define STRUCT_FIELD_USE(...) \
-      f.use = __VA_ARGS__;
+         v.FieldUse(__VA_ARGS__);
 
 #define STRUCT_FIELD_FLAG(flag) \
-      f.flags |= FieldFlag::flag;
+         v.FieldFlags(FieldFlag::flag);
 
 #define STRUCT_FIELD_FLAGS(_flags) \
-      f.flags = _flags;
+         v.SetFieldFlags(_flags);
+
+   // field had other name in old files, several renames are allowed
+#define STRUCT_FIELD_RENAMED(oldName) \
+         v.FieldRenamed(oldName);
 
 #define STRUCT_FIELD(_name) \
-      f.name = #_name; \
-      f.typeID = GetTypeID<decltype(CurrentType{}._name)>(); \
-      f.offset = offsetof(CurrentType, _name); \
-      ti.fields.emplace_back(f); \
-      f = {};
+         v.Field(#_name, &CurrentType::_name, offsetof(CurrentType, _name));
 
 #define STRUCT_END() \
-      Typer::Get().RegisterType(ti.typeID, std::move(ti)); \
-   }};
+      } \
+      \
+      static inline TypeRegisterGuard registerGuard = { GetTypeID<CurrentType>(), [] () { \
+         Typer::Get().RegisterType(GetTypeID<CurrentType>(), MakeStructTypeInfo<CurrentType>(typeName)); \
+      }}; \
+   };
 
 #define ENUM_BEGIN(type) \
    TYPE_BEGIN(type) \
@@ -152,7 +269,8 @@ namespace pbe {
       enumDescCombo += '\0';
 
 #define ENUM_END() \
-      ti.serialize = [](Serializer& ser, const byte* value) { ser.out << *(int*)value; }; \
+      ti.binaryKind = BinaryKind::Raw; \
+      ti.serialize = [](Serializer& ser, const byte* value) { ser.out.Value(*(int*)value); }; \
       ti.deserialize = [](const Deserializer& deser, byte* value) { *(int*)value = deser.node.as<int>(); return true; }; \
       ti.ui = [](const char* name, byte* value) { return ImGui::Combo(name, (int*)value, enumDescCombo.c_str()); }; \
       Typer::Get().RegisterType(ti.typeID, std::move(ti)); \
@@ -162,6 +280,73 @@ namespace pbe {
       using RegisterGuardT::RegisterGuardT;
    };
 
+   template<typename T>
+   struct ComponentStagingT : ComponentStaging {
+      std::vector<entt::entity> entities;
+      std::vector<T> values;
+
+      byte* Add(entt::entity entity) override {
+         entities.emplace_back(entity);
+         return (byte*)&values.emplace_back();
+      }
+
+      void Commit(Scene& scene) override {
+         auto& storage = scene.Storage<T>();
+
+         if constexpr (std::is_empty_v<T>) {
+            storage.insert(entities.begin(), entities.end());
+         } else {
+            storage.insert(entities.begin(), entities.end(), std::make_move_iterator(values.begin()));
+
+            if constexpr (Entity_HasOwner<T>) {
+               for (auto e : entities) {
+                  storage.get(e).owner = Entity{ e, &scene };
+               }
+            }
+         }
+
+         entities.clear();
+         values.clear();
+      }
+   };
+
+   template<typename T>
+   ComponentStorageView MakeComponentStorageView(const Scene& scene) {
+      static_assert(!entt::component_traits<T>::in_place_delete, "storage must be packed");
+
+      const auto* storage = scene.TryStorage<T>();
+      if (!storage || storage->empty()) {
+         return {};
+      }
+
+      ComponentStorageView view;
+      view.set = storage;
+      if constexpr (!std::is_empty_v<T>) {
+         view.pages = (byte* const*)storage->raw();
+         view.pageSize = (uint)entt::component_traits<T>::page_size;
+         view.stride = sizeof(T);
+      }
+      return view;
+   }
+
+   template<typename T, ComponentEvent Event>
+   void ComponentListenerNotify(ComponentListener& listener, entt::registry& registry, entt::entity entity) {
+      listener.OnComponentEvent(entity, GetTypeID<T>(), Event);
+   }
+
+   template<typename T>
+   void ConnectComponentListener(entt::registry& registry, ComponentListener& listener, bool connect) {
+      if (connect) {
+         registry.on_construct<T>().template connect<&ComponentListenerNotify<T, ComponentEvent::Add>>(listener);
+         registry.on_update<T>().template connect<&ComponentListenerNotify<T, ComponentEvent::Update>>(listener);
+         registry.on_destroy<T>().template connect<&ComponentListenerNotify<T, ComponentEvent::Remove>>(listener);
+      } else {
+         registry.on_construct<T>().disconnect(&listener);
+         registry.on_update<T>().disconnect(&listener);
+         registry.on_destroy<T>().disconnect(&listener);
+      }
+   }
+
    void __ComponentUnreg(TypeID typeID);
 
    struct CORE_API ComponentRegisterGuard : RegisterGuardT<decltype([](TypeID typeID) { __ComponentUnreg(typeID); }) > {
@@ -176,6 +361,40 @@ namespace pbe {
       \
       ci.copyCtor = [](Entity& dst, const void* src) { auto srcCompPtr = (Component*)src; return (void*)&dst.Add<Component>((Component&)*srcCompPtr); }; \
       ci.moveCtor = [](Entity& dst, const void* src) { auto srcCompPtr = (Component*)src; return (void*)&dst.Add<Component>((Component&&)*srcCompPtr); }; \
+      ci.copyCtorBatch = [](Scene& scene, std::span<const entt::entity> entities, const void* src) { \
+         Component value = *(const Component*)src; /* src may live in the same storage */ \
+         auto& storage = scene.Storage<Component>(); \
+         storage.insert(entities.begin(), entities.end(), value); \
+         [&](auto& storage) { \
+            if constexpr (Entity_HasOwner<Component>) { \
+               for (auto e : entities) { \
+                  storage.get(e).owner = Entity{ e, &scene }; \
+               } \
+            } \
+         }(storage); \
+      }; \
+      ci.copyStorage = [](const Scene& src, Scene& dst, std::span<const entt::entity> remap) { \
+         auto* srcStorage = src.TryStorage<Component>(); \
+         if (!srcStorage || srcStorage->empty()) { \
+            return; \
+         } \
+         auto& dstStorage = dst.Storage<Component>(); \
+         CopyComponentStorage<Component>(*srcStorage, dstStorage, remap); \
+         [&](auto& storage) { \
+            if constexpr (Entity_HasOwner<Component>) { \
+               for (auto [e, component] : storage.each()) { \
+                  component.owner = Entity{ e, &dst }; \
+               } \
+            } \
+         }(dstStorage); \
+      }; \
+      \
+      ci.createStaging = []() -> Own<ComponentStaging> { return std::make_unique<ComponentStagingT<Component>>(); }; \
+      ci.storageView = [](const Scene& scene) { return MakeComponentStorageView<Component>(scene); }; \
+      ci.connectListener = [](entt::registry& registry, ComponentListener& listener, bool connect) { ConnectComponentListener<Component>(registry, listener, connect); }; \
+      if constexpr (Component_Shared<Component>) { \
+         ci.createPayloadTable = []() -> Own<SharedPayloadTable> { return std::make_unique<SharedPayloadTableT<Component>>(); }; \
+      } \
       \
       ci.has = [](const Entity& e) { return e.Has<Component>(); }; \
       ci.add = [](Entity& e) { return (void*)&e.Add<Component>(); }; \
@@ -220,6 +439,10 @@ namespace pbe {
             func(script); \
          } \
       }; \
+      si.sceneUpdateFunc = [] (Scene& scene, float dt) { \
+         UpdateScripts<Script>(scene.Storage<Script>(), scene.Storage<DisableMarker>(), dt); \
+      }; \
+      si.access = GetAccess<Script>(); \
       \
       typer.RegisterScript(std::move(si)); \
    } \
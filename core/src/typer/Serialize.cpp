@@ -2,6 +2,7 @@
 #include "Serialize.h"
 
 #include "Typer.h"
+#include "core/Log.h"
 
 
 namespace pbe {
@@ -11,25 +12,113 @@ namespace pbe {
    }
 
    bool Serializer::SaveToFile(string_view filename) {
-      std::ofstream fout{ filename.data() };
+      std::ofstream fout{ filename.data(), std::ios::binary };
       fout << out.c_str();
 
-      return true; // todo:
+      return fout.good();
+   }
+
+   Deserializer Deserializer::FromText(string&& text) {
+      auto doc = std::make_shared<TextDocument>();
+
+      Deserializer deser;
+      if (doc->Parse(std::move(text))) {
+         deser.node = doc->Root();
+      }
+      deser.doc = std::move(doc);
+      return deser;
    }
 
    Deserializer Deserializer::FromFile(string_view filename) {
-      std::ifstream fin{ filename.data() };
-      return Deserializer{ YAML::Load(fin) };
+      std::ifstream fin{ filename.data(), std::ios::binary | std::ios::ate };
+      if (!fin) {
+         return {};
+      }
+
+      string text;
+      text.resize((size_t)fin.tellg());
+      fin.seekg(0);
+      fin.read(text.data(), text.size());
+
+      return FromText(std::move(text));
    }
 
    Deserializer Deserializer::FromStr(string_view data) {
-      return Deserializer{ YAML::Load(data.data()) };
+      return FromText(string{ data });
    }
 
-   bool Deserializer::Deser(std::string_view name, TypeID typeID, byte* value) const {
-      return Typer::Get().Deserialize((*this), name, typeID, value);
+   const TypeSchema* SchemaTable::Find(TypeID typeID) const {
+      auto it = types.find(typeID);
+      return it != types.end() ? &it->second : nullptr;
+   }
+
+   // types with fields, which are deserialized by MatchFields
+   static bool HasSchema(const TypeInfo& ti) {
+      return !ti.IsSimpleType() && !ti.deserialize;
+   }
+
+   void SchemaTable::Serialize(Serializer& ser) {
+      const auto& typer = Typer::Get();
+
+      std::vector<const TypeInfo*> types;
+      for (const auto& [_, ti] : typer.types) {
+         if (HasSchema(ti)) {
+            types.emplace_back(&ti);
+         }
+      }
+
+      // stable order of file
+      std::ranges::sort(types, {}, &TypeInfo::name);
+
+      ser.Key("schemas");
+      SERIALIZER_MAP(ser);
+
+      for (const auto* ti : types) {
+         ser.Key(ti->name);
+         SERIALIZER_FLOW_SEQ(ser);
+         ser.out.Value(ti->schemaVersion);
+         ser.out.Value((uint64)ti->schemaHash);
+      }
    }
 
-   Deserializer::Deserializer(YAML::Node node) : node(std::move(node)) {
+   SchemaTable SchemaTable::Deserialize(const TextNode& node) {
+      SchemaTable table;
+      if (!node) {
+         return table;
+      }
+
+      const auto& typer = Typer::Get();
+
+      std::unordered_map<string_view, const TypeInfo*> typesByName;
+      for (const auto& [_, ti] : typer.types) {
+         if (HasSchema(ti)) {
+            typesByName[ti.name] = &ti;
+         }
+      }
+
+      for (TextNode entry : node) {
+         auto it = typesByName.find(entry.Key());
+         if (it == typesByName.end()) {
+            continue;
+         }
+
+         const TypeInfo& ti = *it->second;
+
+         TypeSchema schema;
+         schema.version = entry[0].as<uint>();
+         schema.hash = entry[1].as<uint64>();
+         table.types[ti.typeID] = schema;
+
+         if (schema.hash != ti.schemaHash) {
+            INFO("Type '{}' is changed since file was written (version {} -> {}), its fields are matched by name",
+               ti.name, schema.version, ti.schemaVersion);
+         }
+      }
+
+      return table;
+   }
+
+   bool Deserializer::Deser(std::string_view name, TypeID typeID, byte* value) const {
+      return Typer::Get().Deserialize((*this), name, typeID, value);
    }
 }
@@ -3,15 +3,16 @@
 #include "core/Core.h"
 #include "core/Type.h"
 #include "fs/FileSystem.h"
-
-namespace YAML {
-   class Node;
-   class Emitter;
-}
+#include "TextFormat.h"
+#include "Typer.h"
 
 namespace pbe {
 
    struct CORE_API Serializer {
+      Serializer() = default;
+      // write straight to file, without keeping all text in memory. Call Flush at the end
+      explicit Serializer(string_view filename) : out(filename) {}
+
       template<typename T>
       void Ser(std::string_view name, const T& value) {
          const auto typeID = GetTypeID<T>();
@@ -20,26 +21,84 @@ namespace pbe {
 
       void Ser(std::string_view name, TypeID typeID, const byte* value);
 
-      template<typename Key>
-      void Key(const Key& key) {
-         out << YAML::Key << key << YAML::Value;
+      void Key(string_view key) {
+         out.Key(key);
       }
 
-      template<typename Key, typename Value>
-      void KeyValue(const Key& key, const Value& value) {
-         out << YAML::Key << key << YAML::Value << value;
+      template<typename Value>
+      void KeyValue(string_view key, const Value& value) {
+         out.Key(key);
+         out.Value(value);
       }
 
       const char* Str() const { return out.c_str(); }
       bool SaveToFile(string_view filename);
+      // for file serializer
+      bool Flush() { return out.Flush(); }
+
+      TextWriter out;
+   };
+
+   // schema of struct type, as it was when file was written
+   struct TypeSchema {
+      uint version = 0; // STRUCT_VERSION
+      uint64 hash = 0; // TypeInfo::schemaHash
+   };
+
+   // 'schemas' section of file: schemas of all struct types of typer at the moment of writing.
+   // Values of types with unchanged schema are read by fields order, without lookup of field by name
+   struct CORE_API SchemaTable {
+      std::unordered_map<TypeID, TypeSchema> types;
+
+      // nullptr if type was not registered when file was written
+      const TypeSchema* Find(TypeID typeID) const;
 
-      YAML::Emitter out;
+      static void Serialize(Serializer& ser);
+      // types unknown by typer are skipped
+      static SchemaTable Deserialize(const TextNode& node);
+   };
+
+   // file nodes of fields of one struct value, see Typer::MatchFields
+   struct FieldMatch {
+      TextNode value;
+      uint fileVersion = 0;
+      bool migrate = false; // file has older version of type
+      bool strict = false; // file schema is the same, so fields are in file in fields order
+      TextNode::Iterator next{}; // strict, node of next field
+      std::vector<TextNode> nodes; // not strict, by field index
+
+      // fields must be taken in order. Invalid node - field is absent in file
+      TextNode Field(int idx, std::string_view name, FieldFlag flags) {
+         if (bool(flags & FieldFlag::SkipName)) {
+            return value;
+         }
+         if (!strict) {
+            return nodes[idx];
+         }
+
+         // field may be skipped by 'use' on serialize
+         if (next != value.end() && (*next).Key() == name) {
+            TextNode node = *next;
+            ++next;
+            return node;
+         }
+         return {};
+      }
    };
 
    struct CORE_API Deserializer {
       static Deserializer FromFile(string_view filename);
       static Deserializer FromStr(string_view data);
 
+      Deserializer() = default;
+      Deserializer(TextNode node, const SchemaTable* schemas = nullptr, Scene* scene = nullptr)
+         : node(node), schemas(schemas), scene(scene) {}
+
+      // node of the same document, with the same schemas and scene
+      Deserializer Child(TextNode child) const {
+         return Deserializer{ child, schemas, scene };
+      }
+
       template<typename T>
       T Deser(std::string_view name) const{
          T value;
@@ -65,20 +124,22 @@ namespace pbe {
 
       std::size_t Size() const { return node.size(); }
 
+      // note: child doesnt own document, root deserializer must outlive it
       template <typename Key>
-      const Deserializer operator[](const Key& key) const {
-         return node[key];
-      }
-      
-      template <typename Key>
-      Deserializer operator[](const Key& key) {
-         return node[key];
+      Deserializer operator[](const Key& key) const {
+         return Child(node[key]);
       }
 
-      YAML::Node node;
+      TextNode node;
+      // of file, nullptr if file doesn't have them. Children inherit it
+      const SchemaTable* schemas = nullptr;
+      // entity references are resolved by uuid in it. Children inherit it
+      Scene* scene = nullptr;
 
    private:
-      Deserializer(YAML::Node node);
+      std::shared_ptr<const TextDocument> doc;
+
+      static Deserializer FromText(string&& text);
    };
 
    template<typename T>
@@ -99,11 +160,11 @@ namespace pbe {
 
    struct SerializerMap {
       SerializerMap(Serializer& ser) : ser(ser) {
-         ser.out << YAML::BeginMap;
+         ser.out.BeginMap();
       }
 
       ~SerializerMap() {
-         ser.out << YAML::EndMap;
+         ser.out.EndMap();
       }
 
       Serializer& ser;
@@ -112,16 +173,17 @@ namespace pbe {
 #define SERIALIZER_MAP(ser) SerializerMap serializerMap{ser}
 
    struct SerializerSeq {
-      SerializerSeq(Serializer& ser) : ser(ser) {
-         ser.out << YAML::BeginSeq;
+      SerializerSeq(Serializer& ser, bool flow = false) : ser(ser) {
+         ser.out.BeginSeq(flow);
       }
 
       ~SerializerSeq() {
-         ser.out << YAML::EndSeq;
+         ser.out.EndSeq();
       }
 
       Serializer& ser;
    };
 
 #define SERIALIZER_SEQ(ser) SerializerSeq serializerSeq{ser}
+#define SERIALIZER_FLOW_SEQ(ser) SerializerSeq serializerSeq{ser, true}
 }
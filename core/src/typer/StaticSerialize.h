@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Serialize.h"
+#include "Typer.h"
+#include "core/Log.h"
+#include "core/StringID.h"
+#include "math/Types.h"
+
+
+namespace pbe {
+
+   // Compile time field list of STRUCT_BEGIN type. STRUCT_FIELD list expands into 'Visit' body,
+   // so the same list fills runtime TypeInfo (for UI and tools) and generates direct serialization code.
+   // note: struct used as field must be registered in the same file before, otherwise it goes through runtime TypeInfo
+   template<typename T>
+   struct StructFields {
+      static constexpr bool defined = false;
+   };
+
+   template<typename T>
+   concept HasStructFields = StructFields<T>::defined;
+
+   template<typename T>
+   concept HasSerialize = requires(T a, Serializer & ser) {
+      { a.Serialize(ser) };
+   };
+
+   template<typename T>
+   concept HasDeserialize = requires(T a, const Deserializer & deser) {
+      { a.Deserialize(deser) } -> std::same_as<bool>;
+   };
+
+   template<typename T>
+   concept IsTextScalar = std::is_arithmetic_v<T> || std::is_same_v<T, string>;
+
+   // basic types, that are not text scalars
+   CORE_API void SerializeValue(Serializer& ser, const vec2& v);
+   CORE_API void SerializeValue(Serializer& ser, const vec3& v);
+   CORE_API void SerializeValue(Serializer& ser, const vec4& v);
+   CORE_API void SerializeValue(Serializer& ser, const quat& v);
+   CORE_API void SerializeValue(Serializer& ser, const StringID& v);
+   CORE_API void SerializeValue(Serializer& ser, const Entity& v);
+
+   CORE_API bool DeserializeValue(const Deserializer& deser, vec2& v);
+   CORE_API bool DeserializeValue(const Deserializer& deser, vec3& v);
+   CORE_API bool DeserializeValue(const Deserializer& deser, vec4& v);
+   CORE_API bool DeserializeValue(const Deserializer& deser, quat& v);
+   CORE_API bool DeserializeValue(const Deserializer& deser, StringID& v);
+   CORE_API bool DeserializeValue(const Deserializer& deser, Entity& v);
+
+   // visitor ignores everything except fields by default
+   struct StructVisitorBase {
+      template<typename Func> void TypeUI(Func&&) {}
+      template<typename Func> void TypeSerialize(Func&&) {}
+      template<typename Func> void TypeDeserialize(Func&&) {}
+      void TypeVersion(uint) {}
+      template<typename T, typename Func> void TypeMigration(uint, Func&&) {}
+
+      template<typename Func> void FieldUI(Func&&) {}
+      template<typename Func> void FieldUse(Func&&) {}
+      void FieldFlags(FieldFlag) {}
+      void SetFieldFlags(FieldFlag) {}
+      void FieldRenamed(const char*) {}
+   };
+
+   struct TypeInfoBuilder {
+      TypeInfo& ti;
+      TypeField f{};
+
+      template<typename Func> void TypeUI(Func&& func) { ti.ui = std::forward<Func>(func); }
+      template<typename Func> void TypeSerialize(Func&& func) { ti.serialize = std::forward<Func>(func); }
+      template<typename Func> void TypeDeserialize(Func&& func) { ti.deserialize = std::forward<Func>(func); }
+      void TypeVersion(uint version) { ti.schemaVersion = version; }
+
+      template<typename T, typename Func>
+      void TypeMigration(uint toVersion, Func&& func) {
+         ti.migrations.emplace_back(toVersion, [func = std::forward<Func>(func)](const Deserializer& deser, byte* value) {
+            func(deser, *(T*)value);
+         });
+      }
+
+      template<typename Func> void FieldUI(Func&& ui) { f.ui = std::forward<Func>(ui); }
+      template<typename Func> void FieldUse(Func&& use) { f.use = std::forward<Func>(use); }
+      void FieldFlags(FieldFlag flags) { f.flags |= flags; }
+      void SetFieldFlags(FieldFlag flags) { f.flags = flags; }
+      void FieldRenamed(const char* oldName) { f.oldNames.emplace_back(oldName); }
+
+      template<typename Class, typename FieldType>
+      void Field(const char* name, FieldType Class::*, size_t offset) {
+         f.name = name;
+         f.typeID = GetTypeID<FieldType>();
+         f.offset = offset;
+         ti.fields.emplace_back(std::move(f));
+         f = {};
+      }
+   };
+
+   template<typename T>
+   void StaticSerializeValue(Serializer& ser, const T& value);
+   template<typename T>
+   bool StaticDeserializeValue(const Deserializer& deser, T& value);
+
+   template<typename T>
+   struct StaticSerializeVisitor : StructVisitorBase {
+      Serializer& ser;
+      const T& value;
+      bool use = true;
+      FieldFlag flags = FieldFlag::None;
+
+      StaticSerializeVisitor(Serializer& ser, const T& value) : ser(ser), value(value) {}
+
+      template<typename Func> void FieldUse(Func&& pred) { use = pred((const byte*)&value); }
+      void FieldFlags(FieldFlag f) { flags |= f; }
+      void SetFieldFlags(FieldFlag f) { flags = f; }
+
+      template<typename Class, typename FieldType>
+      void Field(const char* name, FieldType Class::* member, size_t) {
+         if (use) {
+            if (!bool(flags & FieldFlag::SkipName)) {
+               ser.out.Key(name);
+            }
+            StaticSerializeValue(ser, value.*member);
+         }
+         use = true;
+         flags = FieldFlag::None;
+      }
+   };
+
+   template<typename T>
+   struct StaticDeserializeVisitor : StructVisitorBase {
+      const Deserializer& deser;
+      T& value;
+      FieldMatch& match;
+      int fieldIdx = 0;
+      bool success = true;
+      FieldFlag flags = FieldFlag::None;
+
+      StaticDeserializeVisitor(const Deserializer& deser, T& value, FieldMatch& match)
+         : deser(deser), value(value), match(match) {}
+
+      void FieldFlags(FieldFlag f) { flags |= f; }
+      void SetFieldFlags(FieldFlag f) { flags = f; }
+
+      template<typename Class, typename FieldType>
+      void Field(const char* name, FieldType Class::* member, size_t) {
+         // absent field keeps default value
+         if (TextNode node = match.Field(fieldIdx, name, flags)) {
+            success &= StaticDeserializeValue(deser.Child(node), value.*member);
+         }
+         ++fieldIdx;
+         flags = FieldFlag::None;
+      }
+   };
+
+   template<typename T>
+   void StaticSerializeValue(Serializer& ser, const T& value) {
+      if constexpr (HasSerialize<T>) {
+         value.Serialize(ser);
+      } else if constexpr (HasStructFields<T>) {
+         // TYPE_SERIALIZE is known only by TypeInfo, nested value must be written as by Typer
+         const auto& ti = Typer::Get().GetTypeInfo<T>();
+         if (ti.serialize) {
+            ti.serialize(ser, (const byte*)&value);
+            return;
+         }
+
+         SERIALIZER_MAP(ser);
+         StaticSerializeVisitor<T> visitor{ ser, value };
+         StructFields<T>::Visit(visitor);
+      } else if constexpr (std::is_enum_v<T>) {
+         ser.out.Value((int)value);
+      } else if constexpr (IsTextScalar<T>) {
+         ser.out.Value(value);
+      } else if constexpr (requires { SerializeValue(ser, value); }) {
+         SerializeValue(ser, value);
+      } else {
+         Typer::Get().Serialize(ser, {}, GetTypeID<T>(), (const byte*)&value);
+      }
+   }
+
+   template<typename T>
+   bool StaticDeserializeValue(const Deserializer& deser, T& value) {
+      if constexpr (HasDeserialize<T>) {
+         return value.Deserialize(deser);
+      } else if constexpr (HasStructFields<T>) {
+         const auto& typer = Typer::Get();
+         const auto& ti = typer.GetTypeInfo<T>();
+         if (ti.deserialize) {
+            return ti.deserialize(deser, (byte*)&value);
+         }
+
+         FieldMatch match = typer.MatchFields(ti, deser);
+         StaticDeserializeVisitor<T> visitor{ deser, value, match };
+         StructFields<T>::Visit(visitor);
+
+         typer.Migrate(ti, match, deser, (byte*)&value);
+         return visitor.success;
+      } else if constexpr (std::is_enum_v<T>) {
+         value = (T)deser.node.as<int>();
+         return true;
+      } else if constexpr (IsTextScalar<T>) {
+         return deser.node.TryAs(value);
+      } else if constexpr (requires { DeserializeValue(deser, value); }) {
+         return DeserializeValue(deser, value);
+      } else {
+         return Typer::Get().Deserialize(deser, {}, GetTypeID<T>(), (byte*)&value);
+      }
+   }
+
+}
@@ -0,0 +1,797 @@
+#include "pch.h"
+#include "TextFormat.h"
+
+#include "core/Assert.h"
+#include "core/Log.h"
+
+
+namespace pbe {
+
+   constexpr size_t TEXT_WRITER_FLUSH_SIZE = 64 * 1024;
+
+   TextWriter::TextWriter(string_view filename)
+         : file{ filename.data(), std::ios::binary }, toFile(true) {
+      buffer.reserve(TEXT_WRITER_FLUSH_SIZE * 2);
+   }
+
+   TextWriter::~TextWriter() {
+      Flush();
+   }
+
+   void TextWriter::BeginMap() {
+      if (levels.empty()) {
+         levels.push_back({ .scope = Scope::Map });
+         return;
+      }
+
+      auto& level = levels.back();
+      ASSERT(level.scope != Scope::FlowSeq); // todo: flow map
+
+      if (level.scope == Scope::Map) {
+         ASSERT(afterKey);
+         afterKey = false;
+         levels.push_back({ .scope = Scope::Map, .indent = level.indent + 2, .needNewline = true });
+      } else {
+         BeginSeqItem(level);
+         levels.push_back({ .scope = Scope::Map, .indent = level.indent + 2, .inlineStart = true });
+      }
+   }
+
+   void TextWriter::EndMap() {
+      ASSERT(!levels.empty() && levels.back().scope == Scope::Map);
+      auto level = levels.back();
+      levels.pop_back();
+
+      if (level.count == 0) {
+         buffer += level.needNewline ? " {}" : "{}";
+         EndValue();
+      }
+   }
+
+   void TextWriter::BeginSeq(bool flow) {
+      if (flow) {
+         BeginValue();
+         buffer += '[';
+         levels.push_back({ .scope = Scope::FlowSeq });
+         return;
+      }
+
+      if (levels.empty()) {
+         levels.push_back({ .scope = Scope::Seq });
+         return;
+      }
+
+      auto& level = levels.back();
+      ASSERT(level.scope != Scope::FlowSeq);
+
+      if (level.scope == Scope::Map) {
+         ASSERT(afterKey);
+         afterKey = false;
+         levels.push_back({ .scope = Scope::Seq, .indent = level.indent + 2, .needNewline = true });
+      } else {
+         BeginSeqItem(level);
+         levels.push_back({ .scope = Scope::Seq, .indent = level.indent + 2, .inlineStart = true });
+      }
+   }
+
+   void TextWriter::EndSeq() {
+      ASSERT(!levels.empty() && levels.back().scope != Scope::Map);
+      auto level = levels.back();
+      levels.pop_back();
+
+      if (level.scope == Scope::FlowSeq) {
+         buffer += ']';
+         EndValue();
+      } else if (level.count == 0) {
+         buffer += level.needNewline ? " []" : "[]";
+         EndValue();
+      }
+   }
+
+   void TextWriter::Key(string_view key) {
+      ASSERT(!levels.empty() && levels.back().scope == Scope::Map && !afterKey);
+      auto& level = levels.back();
+
+      if (level.count == 0 && level.needNewline) {
+         buffer += '\n';
+         Indent(level.indent);
+      } else if (level.count > 0 || !level.inlineStart) {
+         Indent(level.indent);
+      }
+      ++level.count;
+
+      Scalar(key);
+      buffer += ':';
+      afterKey = true;
+   }
+
+   void TextWriter::Value(bool value) {
+      BeginValue();
+      buffer += value ? "true" : "false";
+      EndValue();
+   }
+
+   void TextWriter::Value(int value) {
+      BeginValue();
+      Number(value);
+      EndValue();
+   }
+
+   void TextWriter::Value(uint value) {
+      BeginValue();
+      Number(value);
+      EndValue();
+   }
+
+   void TextWriter::Value(int64 value) {
+      BeginValue();
+      Number(value);
+      EndValue();
+   }
+
+   void TextWriter::Value(uint64 value) {
+      BeginValue();
+      Number(value);
+      EndValue();
+   }
+
+   void TextWriter::Value(float value) {
+      BeginValue();
+      Number(value);
+      EndValue();
+   }
+
+   void TextWriter::Value(double value) {
+      BeginValue();
+      Number(value);
+      EndValue();
+   }
+
+   void TextWriter::Value(string_view value) {
+      BeginValue();
+      Scalar(value);
+      EndValue();
+   }
+
+   bool TextWriter::Flush() {
+      if (!toFile) {
+         return true;
+      }
+
+      file.write(buffer.data(), buffer.size());
+      buffer.clear();
+      file.flush();
+      return file.good();
+   }
+
+   void TextWriter::Indent(int indent) {
+      buffer.append(indent, ' ');
+   }
+
+   void TextWriter::BeginValue() {
+      if (levels.empty()) {
+         return;
+      }
+
+      auto& level = levels.back();
+      switch (level.scope) {
+      case Scope::Map:
+         ASSERT(afterKey);
+         afterKey = false;
+         buffer += ' ';
+         break;
+      case Scope::Seq:
+         BeginSeqItem(level);
+         break;
+      case Scope::FlowSeq:
+         if (level.count++ > 0) {
+            buffer += ", ";
+         }
+         break;
+      }
+   }
+
+   void TextWriter::EndValue() {
+      if (!levels.empty() && levels.back().scope == Scope::FlowSeq) {
+         return;
+      }
+
+      buffer += '\n';
+
+      if (toFile && buffer.size() >= TEXT_WRITER_FLUSH_SIZE) {
+         Flush();
+      }
+   }
+
+   void TextWriter::BeginSeqItem(Level& level) {
+      if (level.count == 0 && level.needNewline) {
+         buffer += '\n';
+         Indent(level.indent);
+      } else if (level.count > 0 || !level.inlineStart) {
+         Indent(level.indent);
+      }
+      ++level.count;
+
+      buffer += "- ";
+   }
+
+   static bool NeedQuotes(string_view str) {
+      if (str.empty() || str.front() == ' ' || str.back() == ' ') {
+         return true;
+      }
+
+      if (strchr(",[]{}#&*!|>'\"%@`~", str.front())) {
+         return true;
+      }
+      // sequence item, map key or value indicators
+      if (strchr("-?:", str.front()) && (str.size() == 1 || str[1] == ' ')) {
+         return true;
+      }
+
+      for (size_t i = 0; i < str.size(); ++i) {
+         char c = str[i];
+         if (c == '\n' || c == '\r' || c == '\t' || c == '"' || c == '\\') {
+            return true;
+         }
+         if (c == ':' && (i + 1 == str.size() || str[i + 1] == ' ')) {
+            return true;
+         }
+         if (c == '#' && str[i - 1] == ' ') {
+            return true;
+         }
+         if ((c == ',' || c == '[' || c == ']' || c == '{' || c == '}')) {
+            return true; // can be inside flow sequence
+         }
+      }
+
+      return false;
+   }
+
+   void TextWriter::Scalar(string_view str) {
+      if (NeedQuotes(str)) {
+         QuotedScalar(str);
+      } else {
+         buffer += str;
+      }
+   }
+
+   void TextWriter::QuotedScalar(string_view str) {
+      buffer += '"';
+      for (char c : str) {
+         switch (c) {
+         case '"': buffer += "\\\""; break;
+         case '\\': buffer += "\\\\"; break;
+         case '\n': buffer += "\\n"; break;
+         case '\r': buffer += "\\r"; break;
+         case '\t': buffer += "\\t"; break;
+         default: buffer += c;
+         }
+      }
+      buffer += '"';
+   }
+
+   bool TextReader::Parse(string_view text_, TextHandler& handler_) {
+      text = text_;
+      handler = &handler_;
+      pos = 0;
+      lineStart = 0;
+      line = 1;
+      errorLine = 0;
+
+      int column = NextContentLine();
+      if (column < 0) {
+         return true; // empty document
+      }
+
+      if (text.substr(pos, 3) == "---") {
+         pos += 3;
+         SkipSpaces();
+         column = AtLineEnd() ? NextContentLine() : Column();
+         if (column < 0) {
+            return true;
+         }
+      }
+
+      if (!ParseNode(column)) {
+         return false;
+      }
+
+      return NextContentLine() < 0 || Error();
+   }
+
+   bool TextReader::Error() {
+      if (errorLine == 0) {
+         errorLine = line;
+      }
+      return false;
+   }
+
+   int TextReader::NextContentLine() {
+      while (!AtEnd()) {
+         SkipSpaces();
+         if (!AtLineEnd()) {
+            return Column();
+         }
+
+         // skip rest of line
+         while (!AtEnd() && text[pos] != '\n') {
+            ++pos;
+         }
+         if (!AtEnd()) {
+            ++pos;
+            lineStart = pos;
+            ++line;
+         }
+      }
+      return -1;
+   }
+
+   void TextReader::SkipSpaces() {
+      while (!AtEnd() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r')) {
+         ++pos;
+      }
+   }
+
+   bool TextReader::AtLineEnd() {
+      // comment must be separated by space
+      return AtEnd() || text[pos] == '\n'
+         || (text[pos] == '#' && (pos == lineStart || text[pos - 1] == ' ' || text[pos - 1] == '\t'));
+   }
+
+   bool TextReader::IsSeqItem() const {
+      char next = Peek(1);
+      return Peek() == '-' && (next == ' ' || next == '\n' || next == '\r' || next == '\0');
+   }
+
+   bool TextReader::IsMapEntry() const {
+      char quote = Peek();
+      size_t i = pos;
+
+      if (quote == '"' || quote == '\'') {
+         for (++i; i < text.size() && text[i] != '\n'; ++i) {
+            if (text[i] == '\\' && quote == '"') {
+               ++i;
+            } else if (text[i] == quote) {
+               if (quote == '\'' && i + 1 < text.size() && text[i + 1] == '\'') {
+                  ++i;
+                  continue;
+               }
+               ++i;
+               break;
+            }
+         }
+         while (i < text.size() && text[i] == ' ') {
+            ++i;
+         }
+         return i < text.size() && text[i] == ':';
+      }
+
+      if (quote == '[' || quote == '{') {
+         return false;
+      }
+
+      for (; i < text.size() && text[i] != '\n'; ++i) {
+         if (text[i] == ':') {
+            char next = i + 1 < text.size() ? text[i + 1] : '\n';
+            if (next == ' ' || next == '\n' || next == '\r' || next == '\t') {
+               return true;
+            }
+         } else if (text[i] == '#' && i > pos && text[i - 1] == ' ') {
+            return false;
+         }
+      }
+      return false;
+   }
+
+   bool TextReader::ParseNode(int column) {
+      if (IsSeqItem()) {
+         return ParseSeq(column);
+      }
+      if (IsMapEntry()) {
+         return ParseMap(column);
+      }
+
+      if (!ParseInlineValue()) {
+         return false;
+      }
+      NextContentLine();
+      return true;
+   }
+
+   bool TextReader::ParseMap(int column) {
+      handler->BeginMap();
+
+      while (true) {
+         string_view key;
+         if (!ParseScalar(false, key)) {
+            return Error();
+         }
+         handler->Key(key);
+
+         SkipSpaces();
+         if (Peek() != ':') {
+            return Error();
+         }
+         ++pos;
+         SkipSpaces();
+
+         if (AtLineEnd()) {
+            int valueColumn = NextContentLine();
+            if (valueColumn > column) {
+               if (!ParseNode(valueColumn)) {
+                  return false;
+               }
+            } else if (valueColumn == column && IsSeqItem()) {
+               // sequence may have the same indent as its key
+               if (!ParseSeq(column)) {
+                  return false;
+               }
+            } else {
+               handler->Scalar({}); // empty value
+            }
+         } else {
+            if (!ParseInlineValue()) {
+               return false;
+            }
+            NextContentLine();
+         }
+
+         int nextColumn = AtEnd() ? -1 : Column();
+         if (nextColumn != column || IsSeqItem()) {
+            if (nextColumn > column) {
+               return Error();
+            }
+            break;
+         }
+      }
+
+      handler->EndMap();
+      return true;
+   }
+
+   bool TextReader::ParseSeq(int column) {
+      handler->BeginSeq();
+
+      while (true) {
+         ++pos; // '-'
+         SkipSpaces();
+
+         if (AtLineEnd()) {
+            int itemColumn = NextContentLine();
+            if (itemColumn > column) {
+               if (!ParseNode(itemColumn)) {
+                  return false;
+               }
+            } else {
+               handler->Scalar({});
+            }
+         } else if (!ParseNode(Column())) {
+            return false;
+         }
+
+         int nextColumn = AtEnd() ? -1 : Column();
+         if (nextColumn != column || !IsSeqItem()) {
+            if (nextColumn > column) {
+               return Error();
+            }
+            break;
+         }
+      }
+
+      handler->EndSeq();
+      return true;
+   }
+
+   bool TextReader::ParseInlineValue() {
+      if (Peek() == '[') {
+         return ParseFlowSeq();
+      }
+
+      if (Peek() == '{') {
+         ++pos;
+         SkipSpaces();
+         if (Peek() != '}') {
+            return Error(); // todo: flow map
+         }
+         ++pos;
+         handler->BeginMap();
+         handler->EndMap();
+         return true;
+      }
+
+      string_view value;
+      if (!ParseScalar(false, value)) {
+         return Error();
+      }
+      handler->Scalar(value);
+
+      SkipSpaces();
+      return AtLineEnd() || Error();
+   }
+
+   bool TextReader::ParseFlowSeq() {
+      ++pos; // '['
+      handler->BeginSeq();
+
+      auto skipWhitespace = [&] {
+         while (!AtEnd() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+            if (text[pos] == '\n') {
+               lineStart = pos + 1;
+               ++line;
+            }
+            ++pos;
+         }
+      };
+
+      skipWhitespace();
+      if (Peek() == ']') {
+         ++pos;
+         handler->EndSeq();
+         return true;
+      }
+
+      while (true) {
+         skipWhitespace();
+
+         if (Peek() == '[') {
+            if (!ParseFlowSeq()) {
+               return false;
+            }
+         } else {
+            string_view value;
+            if (!ParseScalar(true, value)) {
+               return Error();
+            }
+            handler->Scalar(value);
+         }
+
+         skipWhitespace();
+         if (Peek() == ',') {
+            ++pos;
+         } else if (Peek() == ']') {
+            ++pos;
+            break;
+         } else {
+            return Error();
+         }
+      }
+
+      handler->EndSeq();
+      return true;
+   }
+
+   bool TextReader::ParseScalar(bool inFlow, string_view& value) {
+      char quote = Peek();
+
+      if (quote == '"' || quote == '\'') {
+         ++pos;
+         size_t begin = pos;
+         bool escaped = false;
+
+         while (true) {
+            if (AtEnd() || text[pos] == '\n') {
+               return false;
+            }
+            char c = text[pos];
+            if (quote == '"' && c == '\\') {
+               escaped = true;
+               pos += 2;
+               continue;
+            }
+            if (c == quote) {
+               if (quote == '\'' && Peek(1) == '\'') {
+                  escaped = true;
+                  pos += 2;
+                  continue;
+               }
+               break;
+            }
+            ++pos;
+         }
+
+         value = text.substr(begin, pos - begin);
+         ++pos;
+
+         if (escaped) {
+            unescaped.clear();
+            for (size_t i = 0; i < value.size(); ++i) {
+               char c = value[i];
+               if (quote == '\'') {
+                  unescaped += c;
+                  i += c == '\'';
+                  continue;
+               }
+               if (c != '\\' || i + 1 == value.size()) {
+                  unescaped += c;
+                  continue;
+               }
+               switch (value[++i]) {
+               case 'n': unescaped += '\n'; break;
+               case 'r': unescaped += '\r'; break;
+               case 't': unescaped += '\t'; break;
+               case '0': unescaped += '\0'; break;
+               default: unescaped += value[i];
+               }
+            }
+            value = unescaped;
+         }
+
+         return true;
+      }
+
+      size_t begin = pos;
+      while (!AtEnd()) {
+         char c = text[pos];
+         if (c == '\n' || (c == '#' && pos > begin && text[pos - 1] == ' ')) {
+            break;
+         }
+         if (c == ':' && !inFlow) {
+            char next = Peek(1);
+            if (next == ' ' || next == '\n' || next == '\r' || next == '\t' || next == '\0') {
+               break;
+            }
+         }
+         if (inFlow && (c == ',' || c == ']' || c == '}')) {
+            break;
+         }
+         ++pos;
+      }
+
+      value = text.substr(begin, pos - begin);
+      while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r')) {
+         value.remove_suffix(1);
+      }
+
+      return true;
+   }
+
+   // builds TextDocument nodes from TextReader events
+   struct TextDocumentBuilder : TextHandler {
+      TextDocument& doc;
+
+      std::vector<int> parents;
+      std::vector<int> lastChildren;
+      string_view pendingKey;
+
+      TextDocumentBuilder(TextDocument& doc) : doc(doc) {}
+
+      string_view Store(string_view str) {
+         // views into document text are kept, others are temporary
+         const char* begin = doc.text.data();
+         if (str.empty() || (str.data() >= begin && str.data() + str.size() <= begin + doc.text.size())) {
+            return str;
+         }
+         return doc.unescaped.emplace_back(str);
+      }
+
+      int AddNode(TextDocument::Type type, string_view value = {}) {
+         int idx = (int)doc.nodes.size();
+         doc.nodes.push_back({ .type = type, .key = pendingKey, .value = value });
+         pendingKey = {};
+
+         if (!parents.empty()) {
+            auto& parent = doc.nodes[parents.back()];
+            int& lastChild = lastChildren.back();
+            if (lastChild < 0) {
+               parent.firstChild = idx;
+            } else {
+               doc.nodes[lastChild].nextSibling = idx;
+            }
+            lastChild = idx;
+            ++parent.size;
+         }
+
+         return idx;
+      }
+
+      void Push(TextDocument::Type type) {
+         parents.push_back(AddNode(type));
+         lastChildren.push_back(-1);
+      }
+
+      void Pop() {
+         parents.pop_back();
+         lastChildren.pop_back();
+      }
+
+      void BeginMap() override { Push(TextDocument::Type::Map); }
+      void EndMap() override { Pop(); }
+      void BeginSeq() override { Push(TextDocument::Type::Seq); }
+      void EndSeq() override { Pop(); }
+      void Key(string_view key) override { pendingKey = Store(key); }
+      void Scalar(string_view value) override { AddNode(TextDocument::Type::Scalar, Store(value)); }
+   };
+
+   bool TextDocument::Parse(string&& text_) {
+      text = std::move(text_);
+      nodes.clear();
+      unescaped.clear();
+
+      // scene file has ~4 nodes per line
+      nodes.reserve(std::ranges::count(text, '\n') * 4 + 1);
+
+      TextDocumentBuilder builder{ *this };
+      TextReader reader;
+      if (!reader.Parse(text, builder)) {
+         WARN("Text parse error at line {}", reader.ErrorLine());
+         return false;
+      }
+      return true;
+   }
+
+   bool TextNode::IsMap() const {
+      return *this && doc->nodes[idx].type == TextDocument::Type::Map;
+   }
+
+   bool TextNode::IsSequence() const {
+      return *this && doc->nodes[idx].type == TextDocument::Type::Seq;
+   }
+
+   bool TextNode::IsScalar() const {
+      return *this && doc->nodes[idx].type == TextDocument::Type::Scalar;
+   }
+
+   size_t TextNode::size() const {
+      return *this ? doc->nodes[idx].size : 0;
+   }
+
+   TextNode TextNode::operator[](int i) const {
+      if (!IsSequence()) {
+         return {};
+      }
+
+      int child = doc->nodes[idx].firstChild;
+      while (child >= 0 && i-- > 0) {
+         child = doc->nodes[child].nextSibling;
+      }
+      return { doc, child };
+   }
+
+   TextNode TextNode::operator[](string_view key) const {
+      if (!IsMap()) {
+         return {};
+      }
+
+      for (int child = doc->nodes[idx].firstChild; child >= 0; child = doc->nodes[child].nextSibling) {
+         if (doc->nodes[child].key == key) {
+            return { doc, child };
+         }
+      }
+      return {};
+   }
+
+   string_view TextNode::Key() const {
+      return *this ? doc->nodes[idx].key : string_view{};
+   }
+
+   string_view TextNode::Scalar() const {
+      return *this ? doc->nodes[idx].value : string_view{};
+   }
+
+   TextNode::Iterator& TextNode::Iterator::operator++() {
+      idx = doc->nodes[idx].nextSibling;
+      return *this;
+   }
+
+   TextNode::Iterator TextNode::begin() const {
+      return { doc, IsMap() || IsSequence() ? doc->nodes[idx].firstChild : -1 };
+   }
+
+   bool ParseScalar(string_view str, bool& value) {
+      if (str == "true" || str == "True" || str == "TRUE" || str == "yes" || str == "on") {
+         value = true;
+         return true;
+      }
+      if (str == "false" || str == "False" || str == "FALSE" || str == "no" || str == "off") {
+         value = false;
+         return true;
+      }
+      return false;
+   }
+
+   bool ParseScalar(string_view str, string& value) {
+      value = str;
+      return true;
+   }
+
+}
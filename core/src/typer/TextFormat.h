@@ -0,0 +1,242 @@
+#pragma once
+
+#include <charconv>
+#include <deque>
+#include <fstream>
+
+#include "core/Core.h"
+
+
+namespace pbe {
+
+   // Text format of Serializer, subset of yaml:
+   // block maps and sequences, flow sequences, empty '{}' and '[]', plain, 'single' and "double" quoted scalars, '#' comments.
+   // Numbers are written and parsed by std::to_chars/from_chars
+
+   // writes text straight to memory buffer or to buffered file
+   class CORE_API TextWriter {
+   public:
+      TextWriter() = default;
+      // stream to file, buffer is flushed when it is big enough
+      explicit TextWriter(string_view filename);
+      ~TextWriter();
+
+      TextWriter(TextWriter&&) = default;
+      TextWriter& operator=(TextWriter&&) = default;
+
+      void BeginMap();
+      void EndMap();
+      // flow sequence is written in one line: [1, 2, 3]
+      void BeginSeq(bool flow = false);
+      void EndSeq();
+
+      void Key(string_view key);
+
+      void Value(bool value);
+      void Value(int value);
+      void Value(uint value);
+      void Value(int64 value);
+      void Value(uint64 value);
+      void Value(float value);
+      void Value(double value);
+      void Value(string_view value);
+      void Value(const char* value) { Value(string_view{ value }); }
+      void Value(const string& value) { Value(string_view{ value }); }
+
+      // in memory text. Not valid for file writer
+      const char* c_str() const { return buffer.c_str(); }
+
+      // false if file can't be written
+      bool Flush();
+
+   private:
+      enum class Scope {
+         Map,
+         Seq,
+         FlowSeq,
+      };
+
+      struct Level {
+         Scope scope;
+         int indent = 0;
+         int count = 0;
+         bool needNewline = false; // container is value of key, its first element starts on new line
+         bool inlineStart = false; // container is sequence item, its first element is written after '- '
+      };
+
+      std::vector<Level> levels;
+      bool afterKey = false;
+
+      string buffer;
+      std::ofstream file;
+      bool toFile = false;
+
+      void Indent(int indent);
+      void BeginValue();
+      void EndValue();
+      void BeginSeqItem(Level& level);
+      void Scalar(string_view str);
+      void QuotedScalar(string_view str);
+
+      template<typename T>
+      void Number(T value) {
+         char str[32];
+         auto [end, ec] = std::to_chars(str, str + sizeof(str), value);
+         buffer.append(str, end);
+      }
+   };
+
+   // SAX events of TextReader. Key and Scalar views are valid only during call
+   struct TextHandler {
+      virtual ~TextHandler() = default;
+
+      virtual void BeginMap() = 0;
+      virtual void EndMap() = 0;
+      virtual void BeginSeq() = 0;
+      virtual void EndSeq() = 0;
+      virtual void Key(string_view key) = 0;
+      virtual void Scalar(string_view value) = 0;
+   };
+
+   // event based parser, it doesn't build any tree
+   class CORE_API TextReader {
+   public:
+      // false on syntax error, events before error are already sent
+      bool Parse(string_view text, TextHandler& handler);
+
+      // line of first error
+      int ErrorLine() const { return errorLine; }
+
+   private:
+      string_view text;
+      size_t pos = 0;
+      size_t lineStart = 0;
+      int line = 1;
+      int errorLine = 0;
+      TextHandler* handler = nullptr;
+      string unescaped;
+
+      bool Error();
+
+      int Column() const { return (int)(pos - lineStart); }
+      bool AtEnd() const { return pos >= text.size(); }
+      char Peek(size_t offset = 0) const { return pos + offset < text.size() ? text[pos + offset] : '\0'; }
+
+      // move to first char of next line with content. Returns its column or -1 at the end of text
+      int NextContentLine();
+      void SkipSpaces();
+      bool AtLineEnd();
+
+      bool IsSeqItem() const;
+      bool IsMapEntry() const;
+
+      bool ParseNode(int column);
+      bool ParseMap(int column);
+      bool ParseSeq(int column);
+      bool ParseInlineValue();
+      bool ParseFlowSeq();
+      bool ParseScalar(bool inFlow, string_view& value);
+   };
+
+   struct TextDocument;
+
+   // read only view of parsed node. Valid while TextDocument is alive
+   class CORE_API TextNode {
+   public:
+      TextNode() = default;
+      TextNode(const TextDocument* doc, int idx) : doc(doc), idx(idx) {}
+
+      explicit operator bool() const { return doc && idx >= 0; }
+      bool operator!() const { return !(bool)*this; }
+
+      bool IsMap() const;
+      bool IsSequence() const;
+      bool IsScalar() const;
+
+      // number of children of map or sequence
+      size_t size() const;
+
+      // sequence item, O(i). Use iteration for big sequences
+      TextNode operator[](int i) const;
+      // map value, invalid node if there is no key
+      TextNode operator[](string_view key) const;
+      TextNode operator[](const char* key) const { return (*this)[string_view{ key }]; }
+      TextNode operator[](const string& key) const { return (*this)[string_view{ key }]; }
+
+      // key of map value
+      string_view Key() const;
+      string_view Scalar() const;
+
+      // false if node is not scalar or it can't be parsed to T
+      template<typename T>
+      bool TryAs(T& value) const;
+
+      template<typename T>
+      T as() const {
+         T value{};
+         TryAs(value);
+         return value;
+      }
+
+      struct Iterator {
+         const TextDocument* doc;
+         int idx;
+
+         TextNode operator*() const { return { doc, idx }; }
+         Iterator& operator++();
+         bool operator==(const Iterator&) const = default;
+      };
+
+      Iterator begin() const;
+      Iterator end() const { return { doc, -1 }; }
+
+   private:
+      const TextDocument* doc = nullptr;
+      int idx = -1;
+   };
+
+   // all nodes in one array, scalars are views into text
+   struct CORE_API TextDocument {
+      enum class Type : uint8 {
+         Map,
+         Seq,
+         Scalar,
+      };
+
+      struct Node {
+         Type type;
+         int firstChild = -1;
+         int nextSibling = -1;
+         int size = 0;
+         string_view key;
+         string_view value;
+      };
+
+      string text;
+      std::vector<Node> nodes;
+      std::deque<string> unescaped; // quoted scalars with escapes
+
+      // false on syntax error
+      bool Parse(string&& text);
+
+      TextNode Root() const { return { this, nodes.empty() ? -1 : 0 }; }
+   };
+
+   CORE_API bool ParseScalar(string_view str, bool& value);
+   CORE_API bool ParseScalar(string_view str, string& value);
+
+   template<typename T>
+   bool ParseScalar(string_view str, T& value) requires std::is_arithmetic_v<T> {
+      if (!str.empty() && str[0] == '+') {
+         str.remove_prefix(1);
+      }
+      auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+      return ec == std::errc{} && end == str.data() + str.size();
+   }
+
+   template<typename T>
+   bool TextNode::TryAs(T& value) const {
+      return IsScalar() && ParseScalar(Scalar(), value);
+   }
+
+}
@@ -6,9 +6,42 @@
 #include "fs/FileSystem.h"
 #include "gui/Gui.h"
 #include "scene/Component.h"
+#include "scene/Entity.h"
+#include "scene/Scene.h"
 
 namespace pbe {
 
+   template <class T>
+   static void HashCombine(std::size_t& s, const T& v) {
+      std::hash<T> h;
+      s ^= h(v) + 0x9e3779b9 + (s << 6) + (s >> 2);
+   }
+
+   static uint HashFieldName(std::string_view name) {
+      return entt::hashed_string::value(name.data(), name.size());
+   }
+
+   static void BuildSchema(TypeInfo& ti) {
+      ti.schemaHash = 0;
+      ti.fieldIdxByNameHash.clear();
+
+      HashCombine(ti.schemaHash, ti.schemaVersion);
+
+      for (int i = 0; i < (int)ti.fields.size(); ++i) {
+         const auto& f = ti.fields[i];
+         HashCombine(ti.schemaHash, std::string_view{ f.name });
+         HashCombine(ti.schemaHash, f.typeID);
+         HashCombine(ti.schemaHash, (int)f.flags);
+
+         ti.fieldIdxByNameHash[HashFieldName(f.name)] = i;
+         for (const auto& oldName : f.oldNames) {
+            ti.fieldIdxByNameHash.try_emplace(HashFieldName(oldName), i);
+         }
+      }
+
+      std::ranges::stable_sort(ti.migrations, {}, &TypeMigration::toVersion);
+   }
+
    Typer::Typer() {
       RegisterBasicTypes(*this);
       RegisterBasicComponents(*this);
@@ -31,6 +64,7 @@ namespace pbe {
          ImGui::Text("typeID: %llu", ti.typeID);
          ImGui::Text("sizeof: %d", ti.typeSizeOf);
          ImGui::Text("hasEntityRef: %d", ti.hasEntityRef);
+         ImGui::Text("schema: version %u hash %llu", ti.schemaVersion, ti.schemaHash);
 
          if (!ti.fields.empty()) {
             for (const auto& f : ti.fields) {
@@ -47,22 +81,78 @@ namespace pbe {
 
    void Typer::RegisterType(TypeID typeID, TypeInfo&& ti) {
       ASSERT(types.find(typeID) == types.end());
+      BuildSchema(ti);
       types[typeID] = std::move(ti);
+      UpdateComponentIndex();
    }
 
    void Typer::UnregisterType(TypeID typeID) {
       types.erase(typeID);
+      UpdateComponentIndex();
    }
 
    void Typer::RegisterComponent(ComponentInfo&& ci) {
-      auto it = std::ranges::find(components, ci.typeID, &ComponentInfo::typeID);
-      ASSERT(it == components.end());
+      ASSERT(FindComponentIdx(ci.typeID) < 0);
+      ASSERT_MESSAGE(components.size() < MaxComponents, "Increase MaxComponents");
       components.emplace_back(std::forward<ComponentInfo>(ci));
+      UpdateComponentIndex();
    }
 
    void Typer::UnregisterComponent(TypeID typeID) {
-      auto it = std::ranges::find(components, typeID, &ComponentInfo::typeID);
-      components.erase(it);
+      int idx = FindComponentIdx(typeID);
+      ASSERT(idx >= 0);
+      components.erase(components.begin() + idx);
+      UpdateComponentIndex();
+   }
+
+   ComponentMask Typer::GetComponentMask(const Entity& entity) const {
+      ComponentMask mask;
+      entity.GetScene()->ForEachComponentStorage(entity.GetID(), [&](TypeID typeID) {
+         int idx = FindComponentIdx(typeID);
+         if (idx >= 0) {
+            mask.set(idx);
+         }
+      });
+      return mask;
+   }
+
+   const ComponentInfo* Typer::FindComponent(std::string_view name) const {
+      int idx = FindComponentIdx(name);
+      return idx >= 0 ? &components[idx] : nullptr;
+   }
+
+   const ComponentInfo* Typer::FindComponent(TypeID typeID) const {
+      int idx = FindComponentIdx(typeID);
+      return idx >= 0 ? &components[idx] : nullptr;
+   }
+
+   int Typer::FindComponentIdx(std::string_view name) const {
+      auto it = componentIdxByName.find(name);
+      return it != componentIdxByName.end() ? it->second : -1;
+   }
+
+   int Typer::FindComponentIdx(TypeID typeID) const {
+      auto it = componentIdxByType.find(typeID);
+      return it != componentIdxByType.end() ? it->second : -1;
+   }
+
+   void Typer::UpdateComponentIndex() {
+      componentIdxByName.clear();
+      componentIdxByType.clear();
+
+      for (int i = 0; i < (int)components.size(); ++i) {
+         components[i].idx = i;
+
+         TypeID typeID = components[i].typeID;
+         componentIdxByType[typeID] = i;
+
+         // type info may be registered after component
+         auto it = types.find(typeID);
+         if (it != types.end()) {
+            // note: key points to name in 'types', nodes of unordered_map are stable
+            componentIdxByName[it->second.name] = i;
+         }
+      }
    }
 
    void Typer::RegisterScript(ScriptInfo&& si) {
@@ -129,11 +219,13 @@ namespace pbe {
       const auto& ti = types.at(typeID);
 
       if (!name.empty()) {
-         ser.out << YAML::Key << name.data() << YAML::Value;
+         ser.out.Key(name);
       }
 
       if (ti.serialize) {
          ti.serialize(ser, value);
+      } else if (ti.serializeStatic && useStaticSerialize) {
+         ti.serializeStatic(ser, value);
       } else {
          SERIALIZER_MAP(ser);
 
@@ -151,34 +243,140 @@ namespace pbe {
    bool Typer::Deserialize(const Deserializer& deser, std::string_view name, TypeID typeID, byte* value) const {
       bool hasName = !name.empty();
 
-      if (hasName && !deser[name.data()]) {
+      const Deserializer nodeFields = hasName ? deser[name] : deser;
+      if (hasName && !nodeFields) {
          WARN("Serialization failed! Cant find {}", name);
          return false;
       }
 
       const auto& ti = types.at(typeID);
 
-      const Deserializer& nodeFields = hasName ? deser[name.data()] : deser;
-
       if (ti.deserialize) {
          return ti.deserialize(nodeFields, value);
+      } else if (ti.deserializeStatic && useStaticSerialize) {
+         return ti.deserializeStatic(nodeFields, value);
       } else {
          bool success = true;
 
-         for (const auto& f : ti.fields) {
+         FieldMatch match = MatchFields(ti, nodeFields);
+
+         for (int i = 0; i < (int)ti.fields.size(); ++i) {
+            const auto& f = ti.fields[i];
+
             // todo: all value that use inside lambda should be deserialized before
             // if (!f.Use(value)) {
             //    continue;
             // }
 
-            byte* data = value + f.offset;
-            success &= Deserialize(nodeFields, f.Name(), f.typeID, data);
+            // absent field keeps default value
+            if (TextNode node = match.Field(i, f.name, f.flags)) {
+               byte* data = value + f.offset;
+               success &= Deserialize(nodeFields.Child(node), {}, f.typeID, data);
+            }
          }
 
+         Migrate(ti, match, nodeFields, value);
+
          return success;
       }
    }
 
+   FieldMatch Typer::MatchFields(const TypeInfo& ti, const Deserializer& deser) const {
+      FieldMatch match;
+      match.value = deser.node;
+
+      // file without schemas is matched by names and isn't migrated, e.g. journal record of current scene
+      if (const TypeSchema* schema = deser.schemas ? deser.schemas->Find(ti.typeID) : nullptr) {
+         match.fileVersion = schema->version;
+         match.migrate = schema->version < ti.schemaVersion;
+         match.strict = schema->hash == ti.schemaHash;
+      }
+
+      if (match.strict) {
+         match.next = deser.node.begin();
+         return match;
+      }
+
+      match.nodes.resize(ti.fields.size());
+      if (!deser.node.IsMap()) {
+         return match;
+      }
+
+      for (TextNode node : deser.node) {
+         string_view key = node.Key();
+
+         auto it = ti.fieldIdxByNameHash.find(HashFieldName(key));
+         if (it == ti.fieldIdxByNameHash.end()) {
+            continue; // removed field
+         }
+
+         int idx = it->second;
+         const auto& f = ti.fields[idx];
+
+         bool current = f.name == key;
+         if (!current && std::ranges::find(f.oldNames, key) == f.oldNames.end()) {
+            continue; // hash collision
+         }
+
+         // current name wins over old one
+         if (current || !match.nodes[idx]) {
+            match.nodes[idx] = node;
+         }
+      }
+
+      return match;
+   }
+
+   void Typer::Migrate(const TypeInfo& ti, const FieldMatch& match, const Deserializer& deser, byte* value) const {
+      if (!match.migrate) {
+         return;
+      }
+
+      for (const auto& migration : ti.migrations) {
+         if (migration.toVersion > match.fileVersion) {
+            migration.migrate(deser, value);
+         }
+      }
+   }
+
+   bool BuildBinaryLayout(const TypeInfo& ti, uint offset, BinaryLayout& layout,
+      std::vector<string>* leafNames, std::string_view prefix) {
+      const auto& typer = Typer::Get();
+
+      if (ti.IsSimpleType()) {
+         if (ti.binaryKind == BinaryKind::None) {
+            return false;
+         }
+
+         BinaryLeaf leaf{ offset, (uint)ti.typeSizeOf, ti.binaryKind, ti.typeID };
+         layout.leaves.emplace_back(leaf);
+         layout.stride += leaf.FileSize();
+         if (leafNames) {
+            leafNames->emplace_back(prefix);
+         }
+
+         HashCombine(layout.hash, std::string_view{ ti.name });
+         HashCombine(layout.hash, leaf.size);
+         return true;
+      }
+
+      // migration of new version must be applied, even if fields are the same
+      HashCombine(layout.hash, ti.schemaVersion);
+
+      for (const auto& field : ti.fields) {
+         HashCombine(layout.hash, std::string_view{ field.name });
+         string fieldPrefix;
+         if (leafNames) {
+            fieldPrefix = prefix.empty() ? field.name : std::format("{}.{}", prefix, field.name);
+         }
+         if (!BuildBinaryLayout(typer.GetTypeInfo(field.typeID), offset + (uint)field.offset, layout, leafNames, fieldPrefix)) {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
    void Typer::Finalize() {
       std::unordered_set<TypeID> processedTypeIDs;
 
@@ -1,16 +1,23 @@
 #pragma once
 
+#include <bitset>
+
 #include "core/Core.h"
+#include "core/Ref.h"
 #include "core/Type.h"
+#include "math/Types.h"
+#include "scene/System.h"
 
 
 namespace pbe {
 
    struct Serializer;
    struct Deserializer;
+   struct FieldMatch;
 
    class Entity;
    class Scene;
+   class SharedPayloadTable;
 
    enum class FieldFlag {
       None = 0,
@@ -24,6 +31,8 @@ namespace pbe {
       TypeID typeID;
       size_t offset;
       FieldFlag flags = FieldFlag::None;
+      // STRUCT_FIELD_RENAMED, matched on deserialize
+      std::vector<std::string> oldNames;
 
       const char* Name() const { return bool(flags & FieldFlag::SkipName) ? "" : name.c_str(); }
 
@@ -38,11 +47,28 @@ namespace pbe {
       std::function<bool(const byte*)> use;
    };
 
+   // how simple type is stored in binary scene. None - type can't be stored in binary
+   enum class BinaryKind : uint8 {
+      None,
+      Raw, // bytes as is
+      String,
+      StringID,
+      Entity,
+   };
+
+   // fixes value, that is deserialized by current fields from file with older version of type
+   struct TypeMigration {
+      uint toVersion;
+      // deser - value in file, with old field names
+      std::function<void(const Deserializer&, byte*)> migrate;
+   };
+
    struct TypeInfo {
       std::string name;
       TypeID typeID;
       int typeSizeOf;
       bool hasEntityRef = false;
+      BinaryKind binaryKind = BinaryKind::None;
 
       std::vector<TypeField> fields;
 
@@ -50,28 +76,113 @@ namespace pbe {
       std::function<void(Serializer&, const byte*)> serialize;
       std::function<bool(const Deserializer&, byte*)> deserialize;
 
+      // generated from STRUCT_FIELD list, used instead of fields walk. see StaticSerialize.h
+      void (*serializeStatic)(Serializer&, const byte*) = nullptr;
+      bool (*deserializeStatic)(const Deserializer&, byte*) = nullptr;
+
+      // STRUCT_VERSION, is increased with migration for changes that can't be matched by field names
+      uint schemaVersion = 0;
+      // sorted by toVersion
+      std::vector<TypeMigration> migrations;
+
+      // set by RegisterType
+      size_t schemaHash = 0; // of version, field names, types and flags
+      std::unordered_map<uint, int> fieldIdxByNameHash; // old names too
+
       bool IsSimpleType() const { return fields.empty(); }
    };
 
-   struct ComponentInfo {
-      TypeID typeID;
+   struct BinaryLeaf {
+      uint offset; // in component
+      uint size; // in component
+      BinaryKind kind;
+      TypeID typeID; // simple type
+
+      // strings and entities are stored as uint index
+      uint FileSize() const { return kind == BinaryKind::Raw ? size : sizeof(uint); }
+   };
+
+   // type flattened to simple fields
+   struct BinaryLayout {
+      std::vector<BinaryLeaf> leaves;
+      uint stride = 0; // sum of leaves FileSize
+      size_t hash = 0; // of field names, types and struct versions
+   };
+
+   // false if some of fields can't be stored in binary.
+   // leafNames - optional field path of every leaf, e.g. 'light.color', to match leaves of changed layout
+   CORE_API bool BuildBinaryLayout(const TypeInfo& ti, uint offset, BinaryLayout& layout,
+      std::vector<string>* leafNames = nullptr, std::string_view prefix = {});
+
+   // components of many entities, decoded without touching registry. Used by parallel scene loading
+   struct ComponentStaging {
+      virtual ~ComponentStaging() = default;
 
-      std::function<void* (Entity&, const void*)> copyCtor;
-      std::function<void* (Entity&, const void*)> moveCtor;
+      // default constructed component for entity, pointer is valid until next Add
+      virtual byte* Add(entt::entity entity) = 0;
+      // move all components to scene storage. Entities must not have component
+      virtual void Commit(Scene& scene) = 0;
+   };
+
+   // packed storage of component in scene, component i is in pages[i / pageSize][i % pageSize]
+   struct ComponentStorageView {
+      const entt::sparse_set* set = nullptr; // nullptr if scene doesn't have component
+      byte* const* pages = nullptr; // nullptr for empty types
+      uint pageSize = 0;
+      uint stride = 0; // sizeof component
+
+      uint Size() const { return set ? (uint)set->size() : 0; }
+      byte* At(uint i) const { return pages[i / pageSize] + (size_t)(i % pageSize) * stride; }
+   };
 
-      std::function<bool (const Entity&)> has;
-      std::function<void* (Entity&)> add;
-      std::function<void (Entity&)> remove;
-      std::function<void* (Entity&)> get; // todo: remove?
+   enum class ComponentEvent {
+      Add,
+      Update, // MarkComponentUpdated
+      Remove,
+   };
 
-      std::function<void* (Entity&)> getOrAdd;
-      std::function<void* (Entity&)> tryGet;
-      std::function<const void* (const Entity&)> tryGetConst; // todo: remove?
+   // gets registry signals of components, e.g. for scene journal
+   struct ComponentListener {
+      virtual ~ComponentListener() = default;
+      virtual void OnComponentEvent(entt::entity entity, TypeID typeID, ComponentEvent event) = 0;
+   };
 
-      std::function<void(void*, const void*)> duplicate; // todo: remove
+   // bit per component index in Typer::components
+   constexpr int MaxComponents = 128;
+   using ComponentMask = std::bitset<MaxComponents>;
 
-      std::function<void (Entity&)> patch;
-      std::function<void(void*)> onChanged; // todo: remove?
+   // table of plain function pointers, filled by INTERNAL_ADD_COMPONENT. Called per entity, so no std::function
+   struct ComponentInfo {
+      TypeID typeID;
+      // index in Typer::components. Stable until components are registered or unregistered (dll reload)
+      int idx = -1;
+
+      void* (*copyCtor)(Entity&, const void*) = nullptr;
+      void* (*moveCtor)(Entity&, const void*) = nullptr;
+      // add copy of src to all entities by one storage insert
+      void (*copyCtorBatch)(Scene&, std::span<const entt::entity>, const void*) = nullptr;
+      // copy whole storage of src scene to dst. remap: src entity index -> dst entity
+      void (*copyStorage)(const Scene& src, Scene& dst, std::span<const entt::entity> remap) = nullptr;
+      Own<ComponentStaging> (*createStaging)() = nullptr;
+      // scatter writes through pages, so view of const scene is writable
+      ComponentStorageView (*storageView)(const Scene&) = nullptr;
+      // only for shared components, to dedup values in scene file
+      Own<SharedPayloadTable> (*createPayloadTable)() = nullptr;
+      void (*connectListener)(entt::registry&, ComponentListener&, bool connect) = nullptr;
+
+      bool (*has)(const Entity&) = nullptr;
+      void* (*add)(Entity&) = nullptr;
+      void (*remove)(Entity&) = nullptr;
+      void* (*get)(Entity&) = nullptr; // todo: remove?
+
+      void* (*getOrAdd)(Entity&) = nullptr;
+      void* (*tryGet)(Entity&) = nullptr;
+      const void* (*tryGetConst)(const Entity&) = nullptr; // todo: remove?
+
+      void (*duplicate)(void*, const void*) = nullptr; // todo: remove
+
+      void (*patch)(Entity&) = nullptr;
+      void (*onChanged)(void*) = nullptr; // todo: remove?
 
       // todo:
       // ComponentInfo() = default;
@@ -84,6 +195,11 @@ namespace pbe {
 
       TypeID typeID;
       std::function<void(Scene&, const ApplyFunc&)> sceneApplyFunc;
+      // OnUpdate or static 'UpdateBatch(std::span<Script>, float dt)' for all enabled scripts
+      std::function<void(Scene&, float)> sceneUpdateFunc;
+
+      // components used by OnUpdate, declared by static 'GetAccess()' in script class
+      SystemAccess access;
    };
 
    class CORE_API Typer {
@@ -101,6 +217,26 @@ namespace pbe {
       void RegisterComponent(ComponentInfo&& ci);
       void UnregisterComponent(TypeID typeID);
 
+      // component by type name or by registry storage id. nullptr if it is not component
+      const ComponentInfo* FindComponent(std::string_view name) const;
+      const ComponentInfo* FindComponent(TypeID typeID) const;
+      // index in 'components', -1 if it is not component
+      int FindComponentIdx(std::string_view name) const;
+      int FindComponentIdx(TypeID typeID) const;
+
+      // registered components of entity, by one pass over scene storages
+      ComponentMask GetComponentMask(const Entity& entity) const;
+
+      // components of mask in registration order
+      template<typename Func>
+      void ForEachComponent(const ComponentMask& mask, Func&& func) const {
+         for (int idx = 0; idx < (int)components.size(); ++idx) {
+            if (mask.test(idx)) {
+               func(components[idx]);
+            }
+         }
+      }
+
       void RegisterScript(ScriptInfo&& si);
       void UnregisterScript(TypeID typeID);
 
@@ -120,14 +256,29 @@ namespace pbe {
       void Serialize(Serializer& ser, std::string_view name, TypeID typeID, const byte* value) const;
       bool Deserialize(const Deserializer& deser, std::string_view name, TypeID typeID, byte* value) const;
 
+      // file nodes of struct fields. With the same schema in file fields are taken in order, otherwise by hash of
+      // name. Unknown and removed fields of file are skipped
+      FieldMatch MatchFields(const TypeInfo& ti, const Deserializer& deser) const;
+      // apply migrations of versions newer than in file
+      void Migrate(const TypeInfo& ti, const FieldMatch& match, const Deserializer& deser, byte* value) const;
+
       void Finalize();
 
+      // use generated serialization of structs, if exists. false - always walk fields by TypeInfo
+      bool useStaticSerialize = true;
+
       std::unordered_map<TypeID, TypeInfo> types;
 
       std::vector<ComponentInfo> components;
       std::vector<ScriptInfo> scripts;
 
    private:
+      std::unordered_map<std::string_view, int> componentIdxByName;
+      std::unordered_map<TypeID, int> componentIdxByType;
+
+      // must be called after any change of types or components
+      void UpdateComponentIndex();
+
       void ProcessType(TypeInfo& ti, std::unordered_set<TypeID>& processedTypeIDs);
    };
 
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "Benchmarks.h"
+
+#include "core/CVar.h"
+#include "core/Log.h"
+#include "core/Profiler.h"
+#include "core/UUIDMap.h"
+#include "scene/Scene.h"
+#include "typer/Serialize.h"
+#include "typer/Typer.h"
+
+
+namespace pbe {
+
+   CVarTrigger benchUUIDMap{ "bench/uuid map" };
+   CVarTrigger benchSerialize{ "bench/serialize" };
+
+   // scene/Scene.cpp
+   extern CVarValue<bool> cvBinarySceneCache;
+   string GetAssetsPath(string_view path);
+
+   // prevent optimizing out benchmark results
+   static volatile uint64 gBenchSink = 0;
+
+   template<typename Func>
+   static float BenchMs(int nIterations, Func&& func) {
+      CpuTimer timer;
+      for (int i = 0; i < nIterations; ++i) {
+         func();
+      }
+      return timer.ElapsedMs() / nIterations;
+   }
+
+   static void BenchUUIDMap(int nEntities) {
+      constexpr int N_ITERATIONS = 100;
+
+      std::vector<UUID> uuids(nEntities);
+      std::vector<UUID> lookupUuids = uuids;
+      std::ranges::shuffle(lookupUuids, std::mt19937{});
+
+      float stdInsert = BenchMs(N_ITERATIONS, [&] {
+         std::unordered_map<uint64, entt::entity> map;
+         map.reserve(nEntities);
+         for (int i = 0; i < nEntities; ++i) {
+            map[uuids[i]] = (entt::entity)i;
+         }
+         gBenchSink = gBenchSink + map.size();
+      });
+
+      float flatInsert = BenchMs(N_ITERATIONS, [&] {
+         UUIDMap<entt::entity> map;
+         map.Reserve(nEntities);
+         for (int i = 0; i < nEntities; ++i) {
+            map[uuids[i]] = (entt::entity)i;
+         }
+         gBenchSink = gBenchSink + map.Size();
+      });
+
+      std::unordered_map<uint64, entt::entity> stdMap;
+      UUIDMap<entt::entity> flatMap;
+      for (int i = 0; i < nEntities; ++i) {
+         stdMap[uuids[i]] = (entt::entity)i;
+         flatMap[uuids[i]] = (entt::entity)i;
+      }
+
+      float stdFind = BenchMs(N_ITERATIONS, [&] {
+         uint64 sum = 0;
+         for (auto uuid : lookupUuids) {
+            sum += (uint64)stdMap.find(uuid)->second;
+         }
+         gBenchSink = gBenchSink + sum;
+      });
+
+      float flatFind = BenchMs(N_ITERATIONS, [&] {
+         uint64 sum = 0;
+         for (auto uuid : lookupUuids) {
+            sum += (uint64)*flatMap.Find(uuid);
+         }
+         gBenchSink = gBenchSink + sum;
+      });
+
+      std::vector<entt::entity*> found(nEntities);
+      float flatFindBatch = BenchMs(N_ITERATIONS, [&] {
+         flatMap.FindBatch(lookupUuids, found);
+         uint64 sum = 0;
+         for (auto* e : found) {
+            sum += (uint64)*e;
+         }
+         gBenchSink = gBenchSink + sum;
+      });
+
+      INFO("UUID map, {} entities (ms per pass): insert std {:.4f} flat {:.4f}; find std {:.4f} flat {:.4f} flat batch {:.4f}",
+         nEntities, stdInsert, flatInsert, stdFind, flatFind, flatFindBatch);
+   }
+
+   // SceneSerialize and SceneDeserialize of scene file, with generated struct serializers and with TypeInfo fields walk.
+   // Binary cache must be off, otherwise save writes it too and load reads it instead of text
+   static void BenchSerialize(string_view scenePath) {
+      constexpr int N_ITERATIONS = 3;
+
+      if (cvBinarySceneCache) {
+         WARN("Turn off 'scene/binary cache' for serialize benchmark");
+         return;
+      }
+
+      string path = GetAssetsPath(scenePath);
+      auto scene = SceneDeserialize(path);
+      if (!scene) {
+         return;
+      }
+
+      // saves don't touch the asset
+      string benchPath = fs::path{ path }.replace_extension(".bench.scn").string();
+
+      auto& typer = Typer::Get();
+
+      struct Result {
+         float saveMs;
+         float loadMs;
+         string text;
+      };
+
+      auto run = [&](bool useStatic) {
+         typer.useStaticSerialize = useStatic;
+
+         Result result;
+         result.saveMs = BenchMs(N_ITERATIONS, [&] { SceneSerialize(benchPath, *scene); });
+
+         // loaded scenes are destroyed after timing
+         std::vector<Own<Scene>> loaded;
+         result.loadMs = BenchMs(N_ITERATIONS, [&] { loaded.emplace_back(SceneDeserialize(benchPath)); });
+         gBenchSink += loaded.back() ? loaded.back()->EntitiesCount() : 0;
+
+         std::ifstream file{ benchPath, std::ios::binary };
+         result.text = string{ std::istreambuf_iterator<char>{ file }, {} };
+
+         return result;
+      };
+
+      bool useStaticSerialize = typer.useStaticSerialize;
+      auto fieldsWalk = run(false);
+      auto generated = run(true);
+      typer.useStaticSerialize = useStaticSerialize;
+
+      std::error_code ec;
+      fs::remove(benchPath, ec);
+
+      INFO("Serialize '{}', {} entities (ms per pass): save fields walk {:.3f} generated {:.3f}; load fields walk {:.3f} generated {:.3f}; same text {}",
+         scenePath, scene->EntitiesCount(), fieldsWalk.saveMs, generated.saveMs, fieldsWalk.loadMs, generated.loadMs,
+         fieldsWalk.text == generated.text);
+   }
+
+   void BenchmarksUpdate() {
+      if (benchUUIDMap) {
+         // phys_perf.scn has ~1100 entities
+         BenchUUIDMap(1100);
+         BenchUUIDMap(11000);
+         BenchUUIDMap(110000);
+      }
+
+      // Typer mode is global, so it is switched only while no scene is loaded on workers.
+      // Scenes are loaded async only from main thread, so load can't start during benchmark
+      static bool benchSerializePending = false;
+      benchSerializePending |= benchSerialize;
+
+      if (benchSerializePending && SceneLoadsInFlight() == 0) {
+         benchSerializePending = false;
+         BenchSerialize("phys_perf.scn");
+      }
+   }
+
+}
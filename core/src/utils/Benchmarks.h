@@ -0,0 +1,10 @@
+#pragma once
+
+#include "core/Core.h"
+
+namespace pbe {
+
+   // run benchmarks requested by 'bench/...' triggers, call it once per frame
+   void CORE_API BenchmarksUpdate();
+
+}
@@ -6,6 +6,7 @@
 #include "app/Event.h"
 #include "app/Input.h"
 #include "app/Window.h"
+#include "core/CVar.h"
 #include "core/Profiler.h"
 #include "core/Type.h"
 #include "fs/FileSystem.h"
@@ -13,6 +14,7 @@
 
 #include "scene/Scene.h"
 #include "scene/Entity.h"
+#include "scene/SceneJournal.h"
 #include "scene/Utils.h"
 
 #include "typer/Serialize.h"
@@ -29,6 +31,8 @@ namespace pbe {
 
    constexpr char editorSettingPath[] = "editor.yaml";
 
+   CVarValue<bool> cvSceneJournal{ "editor/scene journal", true };
+
    STRUCT_BEGIN(EditorSettings)
       STRUCT_FIELD(scenePath)
       STRUCT_FIELD(cameraPos)
@@ -53,14 +57,24 @@ namespace pbe {
       viewportWindow->selection = &editorSelection;
       inspectorWindow->selection = &editorSelection;
 
+      // local transform edits are not visible by component signals
+      Undo::Get().onEntityChanged = [this](Scene* scene, UUID uuid, bool parentChanged) {
+         if (sceneJournal && scene == editorScene.get()) {
+            if (parentChanged) {
+               sceneJournal->MarkParentChanged(uuid);
+            } else {
+               sceneJournal->MarkChanged(uuid);
+            }
+         }
+      };
+
       // todo:
       renderer.reset(new Renderer());
       renderer->Init();
       viewportWindow->renderer = renderer.get();
 
       if (!editorSettings.scenePath.empty()) {
-         auto s = SceneDeserialize(editorSettings.scenePath);
-         SetEditorScene(std::move(s));
+         LoadEditorScene(editorSettings.scenePath);
       }
 
       sWindow->SetTitle(std::format("pbe Editor {}", sApplication->GetBuildType()));
@@ -71,7 +85,10 @@ namespace pbe {
    void EditorLayer::OnDetach() {
       ImGui::SetCurrentContext(nullptr);
 
+      editorSceneLoading.Take();
+      Undo::Get().onEntityChanged = {};
       runtimeScene = {};
+      sceneJournal = {};
       editorScene = {};
       UnloadDll();
 
@@ -81,6 +98,12 @@ namespace pbe {
    }
 
    void EditorLayer::OnUpdate(float dt) {
+      ProcessSceneLoading();
+
+      if (sceneJournal) {
+         sceneJournal->Update(dt);
+      }
+
       for (auto& window : editorWindows) {
          if (window->show) {
             window->OnUpdate(dt);
@@ -158,7 +181,7 @@ namespace pbe {
       static bool showImGuiWindow = false;
 
       if (UI_MENU_BAR()) {
-         bool canChangeScene = !runtimeScene;
+         bool canChangeScene = !runtimeScene && !editorSceneLoading;
 
          if (UI_MENU("File")) {
             if (ImGui::MenuItem("New Scene", nullptr, false, canChangeScene)) {
@@ -178,8 +201,7 @@ namespace pbe {
                auto path = OpenFileDialog({ "Scene", "*.scn" });
                if (!path.empty()) {
                   editorSettings.scenePath = path;
-                  auto s = SceneDeserialize(editorSettings.scenePath);
-                  SetEditorScene(std::move(s));
+                  LoadEditorScene(editorSettings.scenePath);
                }
             }
 
@@ -187,6 +209,9 @@ namespace pbe {
                canChangeScene && !editorSettings.scenePath.empty())) {
                if (editorScene) {
                   SceneSerialize(editorSettings.scenePath, *editorScene);
+                  if (sceneJournal) {
+                     sceneJournal->Reset();
+                  }
                }
             }
 
@@ -196,6 +221,7 @@ namespace pbe {
                if (!path.empty()) {
                   editorSettings.scenePath = path;
                   SceneSerialize(editorSettings.scenePath, *editorScene);
+                  ResetSceneJournal();
                }
             }
          }
@@ -248,6 +274,11 @@ namespace pbe {
                   ReloadDll();
                }
             }
+
+            if (editorSceneLoading) {
+               ImGui::SameLine();
+               ImGui::Text("Loading scene %.0f%%", editorSceneLoading.Progress() * 100.f);
+            }
          }
       }
 
@@ -296,8 +327,9 @@ namespace pbe {
          }
 
          if (e->keyCode == KeyCode::Delete) {
+            UndoTransaction undoTransaction;
             for (auto entity : editorSelection.selected) {
-               Undo::Get().Delete(entity); // todo: undo not each but all at once
+               Undo::Get().Delete(entity);
                GetActiveScene()->DestroyImmediate(entity);
             }
             editorSelection.ClearSelection();
@@ -309,8 +341,10 @@ namespace pbe {
             }
 
             if (e->keyCode == KeyCode::Z) {
-               // todo: dont work
-               // Undo::Get().PopAction();
+               Undo::Get().PopAction();
+            }
+            if (e->keyCode == KeyCode::Y) {
+               Undo::Get().RedoAction();
             }
 
             // test message box
@@ -327,8 +361,46 @@ namespace pbe {
    }
 
    void EditorLayer::SetEditorScene(Own<Scene>&& scene) {
+      Undo::Get().Clear();
+      // journal of previous scene is closed, its unsaved changes are discarded
+      sceneJournal = {};
       SetActiveScene(scene.get());
       editorScene = std::move(scene);
+      ResetSceneJournal();
+   }
+
+   void EditorLayer::LoadEditorScene(std::string_view path) {
+      ASSERT(!editorSceneLoading);
+      // autosave snapshot left by crash
+      editorSceneLoading = SceneDeserializeAsync(SceneJournal::RecoveryScenePath(path));
+   }
+
+   void EditorLayer::ProcessSceneLoading() {
+      if (editorSceneLoading && editorSceneLoading.Completed()) {
+         auto scene = editorSceneLoading.Take();
+
+         bool unsaved = std::exchange(editorSceneLoadingUnsaved, false);
+         if (!unsaved && scene && !editorSettings.scenePath.empty()) {
+            unsaved = SceneJournal::Recover(*scene, editorSettings.scenePath);
+            if (unsaved) {
+               INFO("Scene '{}' is recovered from autosave", editorSettings.scenePath);
+            }
+         }
+
+         SetEditorScene(std::move(scene));
+
+         // scene differs from its file, keep it in snapshot
+         if (unsaved && sceneJournal) {
+            sceneJournal->Compact();
+         }
+      }
+   }
+
+   void EditorLayer::ResetSceneJournal() {
+      sceneJournal = {};
+      if (editorScene && cvSceneJournal && !editorSettings.scenePath.empty()) {
+         sceneJournal = std::make_unique<SceneJournal>(*editorScene, editorSettings.scenePath);
+      }
    }
 
    void EditorLayer::SetActiveScene(Scene* scene) {
@@ -378,6 +450,7 @@ namespace pbe {
 
    void EditorLayer::OnStop() {
       runtimeScene->OnStop();
+      Undo::Get().Clear(runtimeScene.get());
       runtimeScene = {};
       SetActiveScene(editorScene.get());
       editorState = State::Edit;
@@ -385,6 +458,9 @@ namespace pbe {
 
    void EditorLayer::TogglePlayStop() {
       if (editorState == State::Edit) {
+         if (!editorScene) {
+            return;
+         }
          OnPlay();
       } else {
          OnStop();
@@ -413,18 +489,42 @@ namespace pbe {
          }
       };
 
+      if (editorSceneLoading) {
+         editorSceneLoading.Wait();
+         ProcessSceneLoading();
+      }
+
       if (dllHandler) {
          if (editorScene) {
-            // todo: do it on RAM
-            INFO("Serialize editor scene for dll reload");
-            SceneSerialize("dllReload.scn", *editorScene);
+            // Registry can't outlive storages of dll types, so scene is kept in memory as binary scene.
+            // Unchanged components are copied as is, changed ones are converted by text
+            std::vector<byte> sceneData;
+            bool inMemory = SceneSerializeBinary(*editorScene, sceneData);
+            if (!inMemory) {
+               INFO("Serialize editor scene for dll reload");
+               SceneSerialize("dllReload.scn", *editorScene);
+            }
+
+            // components of dll types must be destroyed before dll unloading
+            SetEditorScene({});
 
             UnloadDll();
             loadDll();
 
-            INFO("Deserialize editor scene for dll reload");
-            auto reloadedScene = SceneDeserialize("dllReload.scn");
-            SetEditorScene(std::move(reloadedScene));
+            if (inMemory) {
+               CpuTimer timer;
+               SetEditorScene(SceneDeserializeBinary(sceneData, "dll reload", true));
+               INFO("Editor scene is restored after dll reload in {:.1f} ms", timer.ElapsedMs());
+
+               // scene differs from its file, keep it in snapshot
+               if (sceneJournal) {
+                  sceneJournal->Compact();
+               }
+            } else {
+               INFO("Deserialize editor scene for dll reload");
+               LoadEditorScene("dllReload.scn");
+               editorSceneLoadingUnsaved = true;
+            }
          } else {
             UnloadDll();
             loadDll();
@@ -7,14 +7,15 @@
 #include "EditorWindow.h"
 #include "app/Layer.h"
 #include "core/Ref.h"
+#include "scene/Scene.h"
 
 namespace pbe {
    class Renderer;
+   class SceneJournal;
 
    class InspectorWindow;
    class SceneHierarchyWindow;
    class ViewportWindow;
-   class Scene;
    struct Event;
 
    struct EditorSettings {
@@ -38,6 +39,11 @@ namespace pbe {
 
    private:
       void SetEditorScene(Own<Scene>&& scene);
+      // scene is swapped in on frame begin, when loading is completed
+      void LoadEditorScene(std::string_view path);
+      void ProcessSceneLoading();
+      // journal of editor scene for its current path, nullptr if scene has no path
+      void ResetSceneJournal();
       void SetActiveScene(Scene* scene);
       Scene* GetActiveScene();
 
@@ -56,6 +62,9 @@ namespace pbe {
 
       Own<Scene> editorScene;
       Own<Scene> runtimeScene;
+      SceneLoadHandle editorSceneLoading;
+      bool editorSceneLoadingUnsaved = false; // loaded scene differs from scene path, e.g. dll reload
+      Own<SceneJournal> sceneJournal;
       EditorSelection editorSelection;
       EditorSettings editorSettings;
 
@@ -1,56 +1,655 @@
 #include "pch.h"
 #include "Undo.h"
+#include "core/CVar.h"
+#include "scene/Component.h"
 #include "scene/Entity.h"
 #include "typer/Serialize.h"
 
 namespace pbe {
+
+   CVarValue<int> cvUndoMemoryBudgetKb{ "editor/undo/memory budget kb", 16 * 1024 };
+   CVarValue<float> cvUndoCoalesceTime{ "editor/undo/coalesce time", 0.5f };
+
+   constexpr uint64 NULL_ENTITY_UUID = (uint64)entt::null;
+
+   static double GetUndoTime() {
+      using namespace std::chrono;
+      return duration<double>(steady_clock::now().time_since_epoch()).count();
+   }
+
+   static void Append(std::vector<byte>& data, const void* src, size_t size) {
+      data.insert(data.end(), (const byte*)src, (const byte*)src + size);
+   }
+
+   template<typename T>
+   static void Append(std::vector<byte>& data, const T& value) {
+      Append(data, &value, sizeof(T));
+   }
+
+   // size of leaf value in snapshot
+   static uint LeafSize(const BinaryLeaf& leaf, const byte* data) {
+      switch (leaf.kind) {
+      case BinaryKind::String: return sizeof(uint) + *(const uint*)data;
+      case BinaryKind::Entity: return sizeof(uint64);
+      default: return leaf.size; // raw, StringID is interned and can be copied as is
+      }
+   }
+
+   // enabled state after pending enable/disable is processed
+   static bool TargetEnabled(const Entity& entity) {
+      if (entity.Has<DelayedEnableMarker>()) {
+         return true;
+      }
+      return !entity.HasAny<DisableMarker, DelayedDisableMarker>();
+   }
+
    Undo& Undo::Get() {
       static Undo instance;
       return instance;
    }
 
    void Undo::Delete(const Entity& entity) {
-      // todo: dont work with scene hierarchy
+      CloseOpened();
+
+      Action action;
+      action.scene = entity.GetScene();
+
+      // pre-order, so parents are restored before their children
+      for (Entity e = entity; e; e = e.GetTransform().NextInHierarchy(entity)) {
+         EntitySnapshot before;
+         Capture(e, before);
+
+         EntitySnapshot after;
+         after.scene = before.scene;
+         after.uuid = before.uuid;
+
+         Diff(before, after, action);
+      }
 
-      SaveForFuture(entity, false);
-      PushSave();
+      PushAction(std::move(action));
    }
 
-   void Undo::SaveForFuture(const Entity& entity, bool continuous) {
-      if (continuous) {
-         if (entityContinuous == entity) {
-            return;
+   void Undo::SaveForFuture(const Entity& entity) {
+      if (pending.Valid() && pending.scene == entity.GetScene() && pending.uuid == entity.GetUUID()) {
+         return;
+      }
+      Capture(entity, pending);
+   }
+
+   void Undo::PushSave() {
+      CloseOpened();
+
+      if (!pending.Valid()) {
+         return;
+      }
+
+      Entity entity = pending.scene->GetEntity(pending.uuid);
+
+      EntitySnapshot after;
+      if (entity) {
+         Capture(entity, after);
+      } else {
+         after.scene = pending.scene;
+         after.uuid = pending.uuid;
+      }
+
+      Action action;
+      action.scene = pending.scene;
+      Diff(pending, after, action);
+
+      // next edit starts from current state
+      pending = std::move(after);
+
+      if (!action.Empty()) {
+         PushAction(std::move(action));
+      }
+   }
+
+   void Undo::SaveToStack(const Entity& entity, bool continuous) {
+      if (continuous && openedContinuous && opened.scene == entity.GetScene() && opened.uuid == entity.GetUUID()) {
+         return;
+      }
+
+      CloseOpened();
+
+      Capture(entity, opened);
+      openedContinuous = continuous;
+   }
+
+   void Undo::BeginTransaction() {
+      CloseOpened();
+
+      if (transactionDepth++ == 0) {
+         transaction = {};
+      }
+   }
+
+   void Undo::EndTransaction() {
+      ASSERT(transactionDepth > 0);
+      CloseOpened();
+
+      if (--transactionDepth == 0 && !transaction.Empty()) {
+         PushAction(std::move(transaction));
+      }
+   }
+
+   void Undo::PopAction() {
+      CloseOpened();
+
+      if (undoStack.empty()) {
+         return;
+      }
+
+      Action action = std::move(undoStack.back());
+      undoStack.pop_back();
+
+      Apply(action, true);
+      redoStack.emplace_back(std::move(action));
+   }
+
+   void Undo::RedoAction() {
+      CloseOpened();
+
+      if (redoStack.empty()) {
+         return;
+      }
+
+      Action action = std::move(redoStack.back());
+      redoStack.pop_back();
+
+      Apply(action, false);
+      undoStack.emplace_back(std::move(action));
+   }
+
+   void Undo::Clear(const Scene* scene) {
+      auto remove = [&](auto& actions) {
+         std::erase_if(actions, [&](const Action& action) { return !scene || action.scene == scene; });
+      };
+      remove(undoStack);
+      remove(redoStack);
+
+      if (!scene || pending.scene == scene) {
+         pending = {};
+      }
+      if (!scene || opened.scene == scene) {
+         opened = {};
+      }
+      if (!scene) {
+         // types may be changed by dll reload
+         layouts.clear();
+      }
+
+      memoryUsage = 0;
+      for (const auto& action : undoStack) {
+         memoryUsage += action.Memory();
+      }
+      for (const auto& action : redoStack) {
+         memoryUsage += action.Memory();
+      }
+   }
+
+   const BinaryLayout* Undo::GetLayout(TypeID typeID) {
+      auto it = layouts.find(typeID);
+      if (it == layouts.end()) {
+         auto layout = std::make_unique<BinaryLayout>();
+         if (!BuildBinaryLayout(Typer::Get().GetTypeInfo(typeID), 0, *layout)) {
+            layout = {};
+         }
+         it = layouts.emplace(typeID, std::move(layout)).first;
+      }
+      return it->second.get();
+   }
+
+   void Undo::Capture(const Entity& entity, EntitySnapshot& snapshot) {
+      snapshot.scene = entity.GetScene();
+      snapshot.uuid = entity.GetUUID();
+      snapshot.items.clear();
+      snapshot.data.clear();
+
+      auto& data = snapshot.data;
+      auto addItem = [&](ChangeKind kind, TypeID typeID, auto&& write) {
+         uint offset = (uint)data.size();
+         write();
+         snapshot.items.push_back({ kind, typeID, offset, (uint)data.size() - offset });
+      };
+
+      addItem(ChangeKind::Exists, InvalidTypeID, [] {});
+
+      const auto& trans = entity.GetTransform();
+      addItem(ChangeKind::Parent, InvalidTypeID, [&] {
+         Append(data, trans.parent ? (uint64)trans.parent.GetUUID() : NULL_ENTITY_UUID);
+         Append(data, trans.GetChildIdx());
+      });
+
+      addItem(ChangeKind::Name, InvalidTypeID, [&] {
+         const char* name = entity.GetName();
+         Append(data, name, strlen(name));
+      });
+
+      addItem(ChangeKind::Transform, InvalidTypeID, [&] {
+         Append(data, trans.LocalPosition());
+         Append(data, trans.LocalRotation());
+         Append(data, trans.LocalScale());
+      });
+
+      const auto& typer = Typer::Get();
+
+      std::vector<int> componentIdxs;
+      typer.ForEachComponent(typer.GetComponentMask(entity), [&](const ComponentInfo& ci) {
+         componentIdxs.push_back(ci.idx);
+      });
+      std::ranges::sort(componentIdxs, {}, [&](int idx) { return typer.components[idx].typeID; });
+
+      for (int idx : componentIdxs) {
+         const auto& ci = typer.components[idx];
+         const byte* component = (const byte*)ci.tryGetConst(entity);
+
+         addItem(ChangeKind::Component, ci.typeID, [&] {
+            const auto* layout = GetLayout(ci.typeID);
+            if (!layout) {
+               // fallback to text
+               Serializer ser;
+               typer.Serialize(ser, {}, ci.typeID, component);
+               Append(data, ser.Str(), strlen(ser.Str()));
+               return;
+            }
+
+            for (const auto& leaf : layout->leaves) {
+               const byte* value = component + leaf.offset;
+               switch (leaf.kind) {
+               case BinaryKind::String: {
+                  const auto& str = *(const string*)value;
+                  Append(data, (uint)str.size());
+                  Append(data, str.data(), str.size());
+                  break;
+               }
+               case BinaryKind::Entity: {
+                  const auto& e = *(const Entity*)value;
+                  Append(data, e.Valid() ? (uint64)e.GetUUID() : NULL_ENTITY_UUID);
+                  break;
+               }
+               default:
+                  Append(data, value, leaf.size);
+               }
+            }
+         });
+      }
+
+      addItem(ChangeKind::Enabled, InvalidTypeID, [&] {
+         Append(data, (uint8)TargetEnabled(entity));
+      });
+   }
+
+   void Undo::Diff(const EntitySnapshot& before, const EntitySnapshot& after, Action& action) {
+      ASSERT(before.uuid == after.uuid);
+
+      auto& data = action.data;
+      auto addChange = [&](ChangeKind kind, TypeID typeID, uint leaf, const byte* b, uint bSize, const byte* a, uint aSize) {
+         Change change{ .entity = before.uuid, .kind = kind, .typeID = typeID, .leaf = leaf };
+         if (b) {
+            change.before = (uint)data.size();
+            change.beforeSize = bSize;
+            Append(data, b, bSize);
+         }
+         if (a) {
+            change.after = (uint)data.size();
+            change.afterSize = aSize;
+            Append(data, a, aSize);
+         }
+         action.changes.emplace_back(change);
+      };
+
+      auto key = [](const SnapshotItem& item) { return std::pair{ item.kind, item.typeID }; };
+
+      size_t iBefore = 0;
+      size_t iAfter = 0;
+      while (iBefore < before.items.size() || iAfter < after.items.size()) {
+         const SnapshotItem* b = iBefore < before.items.size() ? &before.items[iBefore] : nullptr;
+         const SnapshotItem* a = iAfter < after.items.size() ? &after.items[iAfter] : nullptr;
+
+         if (b && (!a || key(*b) < key(*a))) {
+            addChange(b->kind, b->typeID, 0, before.data.data() + b->offset, b->size, nullptr, 0);
+            ++iBefore;
+            continue;
+         }
+         if (a && (!b || key(*a) < key(*b))) {
+            addChange(a->kind, a->typeID, 0, nullptr, 0, after.data.data() + a->offset, a->size);
+            ++iAfter;
+            continue;
+         }
+
+         ++iBefore;
+         ++iAfter;
+
+         const byte* bData = before.data.data() + b->offset;
+         const byte* aData = after.data.data() + a->offset;
+         if (b->size == a->size && memcmp(bData, aData, b->size) == 0) {
+            continue;
+         }
+
+         const auto* layout = b->kind == ChangeKind::Component ? GetLayout(b->typeID) : nullptr;
+         if (!layout) {
+            addChange(b->kind, b->typeID, 0, bData, b->size, aData, a->size);
+            continue;
+         }
+
+         for (uint iLeaf = 0; iLeaf < (uint)layout->leaves.size(); ++iLeaf) {
+            const auto& leaf = layout->leaves[iLeaf];
+            uint bSize = LeafSize(leaf, bData);
+            uint aSize = LeafSize(leaf, aData);
+            if (bSize != aSize || memcmp(bData, aData, bSize) != 0) {
+               addChange(ChangeKind::Field, b->typeID, iLeaf, bData, bSize, aData, aSize);
+            }
+            bData += bSize;
+            aData += aSize;
+         }
+      }
+   }
+
+   // Steps of transaction are undone backwards, e.g. two edits of the same field undo to the first 'before'.
+   // Changes of one step keep their order, so parents are still restored before their children
+   std::vector<const Undo::Change*> Undo::ApplyOrder(const Action& action, bool useBefore) {
+      std::vector<const Change*> order;
+      order.reserve(action.changes.size());
+
+      if (!useBefore || action.steps.size() < 2) {
+         for (const auto& change : action.changes) {
+            order.emplace_back(&change);
+         }
+         return order;
+      }
+
+      for (size_t iStep = action.steps.size(); iStep-- > 0; ) {
+         size_t begin = action.steps[iStep];
+         size_t end = iStep + 1 < action.steps.size() ? action.steps[iStep + 1] : action.changes.size();
+         for (size_t i = begin; i < end; ++i) {
+            order.emplace_back(&action.changes[i]);
+         }
+      }
+      return order;
+   }
+
+   void Undo::Apply(const Action& action, bool useBefore) {
+      Scene& scene = *action.scene;
+      NotifyChanged(action);
+
+      const auto order = ApplyOrder(action, useBefore);
+
+      auto value = [&](const Change& change) -> std::pair<const byte*, uint> {
+         uint offset = useBefore ? change.before : change.after;
+         if (offset == NONE) {
+            return { nullptr, 0 };
+         }
+         return { action.data.data() + offset, useBefore ? change.beforeSize : change.afterSize };
+      };
+
+      // restore entities. They are disabled until all components are restored
+      for (const auto& change : action.changes) {
+         if (change.kind == ChangeKind::Exists && value(change).first) {
+            Entity entity = scene.CreateWithUUID(change.entity, Entity{});
+            entity.Add<DisableMarker>();
+         }
+      }
+
+      // hierarchy before other values, changes are in pre-order
+      for (const Change* pChange : order) {
+         const Change& change = *pChange;
+         if (change.kind == ChangeKind::Parent) {
+            if (auto [data, size] = value(change); data) {
+               Entity entity = scene.GetEntity(change.entity);
+               ApplyValue(entity, change, data, size);
+            }
+         }
+      }
+
+      for (const Change* pChange : order) {
+         const Change& change = *pChange;
+         if (change.kind == ChangeKind::Exists || change.kind == ChangeKind::Parent) {
+            continue;
+         }
+
+         Entity entity = scene.GetEntity(change.entity);
+         if (!entity) {
+            continue; // will be destroyed
+         }
+
+         auto [data, size] = value(change);
+         if (data) {
+            ApplyValue(entity, change, data, size);
+         } else if (change.kind == ChangeKind::Component) {
+            if (const auto* ci = Typer::Get().FindComponent(change.typeID)) {
+               ci->remove(entity);
+            }
+         }
+      }
+
+      // children are destroyed before their parents
+      for (auto it = action.changes.rbegin(); it != action.changes.rend(); ++it) {
+         if (it->kind == ChangeKind::Exists && !value(*it).first) {
+            if (Entity entity = scene.GetEntity(it->entity)) {
+               scene.DestroyImmediate(entity, false);
+            }
+         }
+      }
+
+      // edit may be continued from restored state
+      pending = {};
+   }
+
+   void Undo::ApplyValue(Entity& entity, const Change& change, const byte* value, uint size) {
+      auto& trans = entity.GetTransform();
+      Scene& scene = *entity.GetScene();
+
+      switch (change.kind) {
+      case ChangeKind::Parent: {
+         uint64 parentUUID = *(const uint64*)value;
+         int childIdx = *(const int*)(value + sizeof(uint64));
+         Entity parent = parentUUID != NULL_ENTITY_UUID ? scene.GetEntity(parentUUID) : Entity{};
+         trans.SetParent(parent, childIdx, true);
+         break;
+      }
+      case ChangeKind::Name:
+         entity.SetName(std::string_view{ (const char*)value, size });
+         break;
+      case ChangeKind::Transform:
+         trans.SetLocalPosition(*(const vec3*)value);
+         trans.SetLocalRotation(*(const quat*)(value + sizeof(vec3)));
+         trans.SetLocalScale(*(const vec3*)(value + sizeof(vec3) + sizeof(quat)));
+         break;
+      case ChangeKind::Enabled:
+         if (*value) {
+            scene.EntityEnable(entity, false);
+         } else {
+            scene.EntityDisable(entity, false);
+         }
+         break;
+      case ChangeKind::Component:
+      case ChangeKind::Field: {
+         const auto* ci = Typer::Get().FindComponent(change.typeID);
+         if (!ci) {
+            WARN("Undo: component {} is not registered", change.typeID);
+            break;
+         }
+
+         byte* component = (byte*)ci->getOrAdd(entity);
+         const auto* layout = GetLayout(change.typeID);
+
+         if (change.kind == ChangeKind::Component) {
+            DecodeComponent(layout, change.typeID, scene, value, size, component);
          } else {
-            entityContinuous = entity;
+            BinaryLayout leafLayout;
+            leafLayout.leaves.emplace_back(layout->leaves[change.leaf]);
+            DecodeComponent(&leafLayout, change.typeID, scene, value, size, component);
          }
+
+         if (ci->onChanged) {
+            ci->onChanged(component);
+         }
+         // update handlers check enabled state themselves
+         ci->patch(entity);
+         break;
+      }
+      default:
+         break;
+      }
+   }
+
+   void Undo::DecodeComponent(const BinaryLayout* layout, TypeID typeID, Scene& scene, const byte* data, uint size, byte* component) {
+      if (!layout) {
+         auto deser = Deserializer::FromStr(std::string_view{ (const char*)data, size });
+         Typer::Get().Deserialize(deser, {}, typeID, component);
+         return;
+      }
+
+      for (const auto& leaf : layout->leaves) {
+         byte* dst = component + leaf.offset;
+         switch (leaf.kind) {
+         case BinaryKind::String: {
+            uint length = *(const uint*)data;
+            ((string*)dst)->assign((const char*)data + sizeof(uint), length);
+            break;
+         }
+         case BinaryKind::Entity: {
+            uint64 uuid = *(const uint64*)data;
+            *(Entity*)dst = uuid != NULL_ENTITY_UUID ? scene.GetEntity(uuid) : Entity{};
+            break;
+         }
+         default:
+            memcpy(dst, data, leaf.size);
+         }
+         data += LeafSize(leaf, data);
+      }
+   }
+
+   void Undo::CloseOpened() {
+      if (!opened.Valid()) {
+         return;
+      }
+
+      EntitySnapshot before = std::move(opened);
+      opened = {};
+      openedContinuous = false;
+
+      Action action;
+      action.scene = before.scene;
+
+      EntitySnapshot after;
+      if (Entity entity = before.scene->GetEntity(before.uuid)) {
+         Capture(entity, after);
       } else {
-         entityContinuous = {};
+         after.scene = before.scene;
+         after.uuid = before.uuid;
       }
+      Diff(before, after, action);
 
-      // todo: dont work with scene hierarchy
+      if (!action.Empty()) {
+         PushAction(std::move(action));
+      }
+   }
 
-      Serializer ser;
-      EntitySerialize(ser, entity);
-      string saveData = ser.Str(); // todo: move to lambda
+   void Undo::NotifyChanged(const Action& action) {
+      if (!onEntityChanged) {
+         return;
+      }
 
-      undoAction = [entity, saveData]() {
-         Deserializer deser = Deserializer::FromStr(saveData);
-         EntityDeserialize(deser, *entity.GetScene());
-      };
+      for (const auto& change : action.changes) {
+         onEntityChanged(action.scene, change.entity, change.kind == ChangeKind::Parent);
+      }
    }
 
-   void Undo::PushSave() {
-      if (!undoAction) {
+   void Undo::PushAction(Action&& action) {
+      // remembered state may be changed by this action
+      pending = {};
+      NotifyChanged(action);
+
+      if (transactionDepth > 0) {
+         if (!transaction.scene) {
+            transaction.scene = action.scene;
+         }
+         ASSERT(transaction.scene == action.scene);
+
+         transaction.steps.emplace_back((uint)transaction.changes.size());
+
+         uint offset = (uint)transaction.data.size();
+         transaction.data.insert(transaction.data.end(), action.data.begin(), action.data.end());
+         for (auto change : action.changes) {
+            if (change.before != NONE) {
+               change.before += offset;
+            }
+            if (change.after != NONE) {
+               change.after += offset;
+            }
+            transaction.changes.emplace_back(change);
+         }
          return;
       }
 
-      undoStack.emplace(std::move(undoAction));
-      // INFO("Edited"); // todo:
+      for (const auto& redo : redoStack) {
+         memoryUsage -= redo.Memory();
+      }
+      redoStack.clear();
+
+      double time = GetUndoTime();
+      action.time = time;
+
+      // coalesce repeated edit of the same fields, e.g. slider drag: keep first 'before' and take new 'after'
+      if (!undoStack.empty()) {
+         Action& top = undoStack.back();
+
+         bool sameFields = top.scene == action.scene && top.changes.size() == action.changes.size()
+            && time - top.time < cvUndoCoalesceTime;
+         for (size_t i = 0; sameFields && i < action.changes.size(); ++i) {
+            sameFields = top.changes[i].SameKey(action.changes[i]);
+         }
+
+         if (sameFields) {
+            Action merged;
+            merged.scene = top.scene;
+            merged.steps = top.steps;
+            merged.time = time;
+            merged.changes.reserve(top.changes.size());
+
+            for (size_t i = 0; i < top.changes.size(); ++i) {
+               Change change = top.changes[i];
+               const Change& next = action.changes[i];
+
+               if (change.before != NONE) {
+                  uint offset = (uint)merged.data.size();
+                  Append(merged.data, top.data.data() + change.before, change.beforeSize);
+                  change.before = offset;
+               }
+
+               change.after = NONE;
+               change.afterSize = next.afterSize;
+               if (next.after != NONE) {
+                  change.after = (uint)merged.data.size();
+                  Append(merged.data, action.data.data() + next.after, next.afterSize);
+               }
+
+               merged.changes.emplace_back(change);
+            }
+
+            memoryUsage -= top.Memory();
+            top = std::move(merged);
+            memoryUsage += top.Memory();
+            return;
+         }
+      }
+
+      memoryUsage += action.Memory();
+      undoStack.emplace_back(std::move(action));
+
+      TrimMemory();
    }
 
-   void Undo::SaveToStack(const Entity& entity, bool continuous) {
-      SaveForFuture(entity, continuous);
-      PushSave();
+   void Undo::TrimMemory() {
+      size_t budget = (size_t)std::max((int)cvUndoMemoryBudgetKb, 0) * 1024;
+
+      // the last action is kept even if it is over budget
+      while (memoryUsage > budget && undoStack.size() > 1) {
+         memoryUsage -= undoStack.front().Memory();
+         undoStack.pop_front();
+      }
    }
 
 }
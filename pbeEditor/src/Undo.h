@@ -4,35 +4,138 @@
 
 namespace pbe {
 
-   // class Entity;
-
+   // Undo stores binary before/after values only of changed fields. Components are flattened to fields by
+   // BinaryLayout of Typer, entities are referenced by UUID, so actions survive entity destroy and restore
    class Undo {
    public:
       static Undo& Get();
 
       // todo: bad naming
 
+      // call before entity destroy, whole subtree is saved
       void Delete(const Entity& entity);
 
-      void SaveForFuture(const Entity& entity, bool continuous = false);
+      // remember entity state before edit. Nothing to do if entity is already remembered
+      void SaveForFuture(const Entity& entity);
+      // push changes of remembered entity. Repeated edits of the same fields are coalesced into one action
       void PushSave();
 
+      // start edit, changes are pushed by next action, undo or redo.
+      // continuous - repeated calls for the same entity are one edit (gizmo drag)
       void SaveToStack(const Entity& entity, bool continuous = false);
 
+      // all actions inside transaction are one undo step
+      void BeginTransaction();
+      void EndTransaction();
+
       // todo: name
-      void PopAction() {
-         if (!undoStack.empty()) {
-            auto undoFunc = undoStack.top();
-            undoFunc();
-            undoStack.pop();
-         }
-      }
+      void PopAction();
+      void RedoAction();
+
+      // remove actions of scene, all actions if scene is nullptr
+      void Clear(const Scene* scene = nullptr);
+
+      size_t MemoryUsage() const { return memoryUsage; }
+
+      // called for every entity of pushed, undone or redone action. E.g. local transform edit has no component signal.
+      // parentChanged - parent or child index of entity is changed
+      std::function<void(Scene* scene, UUID uuid, bool parentChanged)> onEntityChanged;
 
    private:
-      std::stack<std::function<void()>> undoStack;
-      std::function<void()> undoAction;
+      // snapshot items and changes. Order is order of apply
+      enum class ChangeKind : uint8 {
+         Exists, // entity created or destroyed, no data
+         Parent, // parent uuid and child idx
+         Name,
+         Transform, // local position, rotation, scale
+         Component, // whole component
+         Field, // one leaf of component layout
+         Enabled,
+      };
+
+      static constexpr uint NONE = UINT32_MAX;
+
+      struct Change {
+         UUID entity;
+         ChangeKind kind;
+         TypeID typeID = InvalidTypeID;
+         uint leaf = 0;
+         // offsets in Action::data. NONE - value is absent, e.g. component was added or removed
+         uint before = NONE;
+         uint beforeSize = 0;
+         uint after = NONE;
+         uint afterSize = 0;
+
+         bool SameKey(const Change& rhs) const {
+            return entity == rhs.entity && kind == rhs.kind && typeID == rhs.typeID && leaf == rhs.leaf;
+         }
+      };
+
+      struct Action {
+         Scene* scene = nullptr;
+         std::vector<Change> changes;
+         std::vector<byte> data;
+         // first change of every action pushed into transaction, empty for single action
+         std::vector<uint> steps;
+         double time = 0; // of last update, seconds
+
+         bool Empty() const { return changes.empty(); }
+         size_t Memory() const {
+            return sizeof(Action) + changes.capacity() * sizeof(Change) + data.capacity() + steps.capacity() * sizeof(uint);
+         }
+      };
+
+      struct SnapshotItem {
+         ChangeKind kind;
+         TypeID typeID = InvalidTypeID;
+         uint offset = 0;
+         uint size = 0;
+      };
+
+      struct EntitySnapshot {
+         Scene* scene = nullptr;
+         UUID uuid;
+         std::vector<SnapshotItem> items; // sorted by kind and typeID
+         std::vector<byte> data;
+
+         bool Valid() const { return scene != nullptr; }
+      };
+
+      std::deque<Action> undoStack;
+      std::vector<Action> redoStack;
+      size_t memoryUsage = 0;
+
+      // remembered by SaveForFuture
+      EntitySnapshot pending;
+
+      // opened by SaveToStack
+      EntitySnapshot opened;
+      bool openedContinuous = false;
+
+      int transactionDepth = 0;
+      Action transaction;
+
+      std::unordered_map<TypeID, Own<BinaryLayout>> layouts; // nullptr if type can't be stored in binary
+
+      const BinaryLayout* GetLayout(TypeID typeID);
+
+      void Capture(const Entity& entity, EntitySnapshot& snapshot);
+      void Diff(const EntitySnapshot& before, const EntitySnapshot& after, Action& action);
+      static std::vector<const Change*> ApplyOrder(const Action& action, bool useBefore);
+      void Apply(const Action& action, bool useBefore);
+      void NotifyChanged(const Action& action);
+
+      void ApplyValue(Entity& entity, const Change& change, const byte* value, uint size);
+      void DecodeComponent(const BinaryLayout* layout, TypeID typeID, Scene& scene, const byte* data, uint size, byte* component);
+
+      void CloseOpened();
+      void PushAction(Action&& action);
+      void TrimMemory();
+   };
 
-      Entity entityContinuous;
+   struct UndoTransaction {
+      UndoTransaction() { Undo::Get().BeginTransaction(); }
+      ~UndoTransaction() { Undo::Get().EndTransaction(); }
    };
 
 }
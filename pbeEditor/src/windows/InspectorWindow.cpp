@@ -24,12 +24,22 @@ namespace pbe {
 
       auto contentRegionAvail = ImGui::GetContentRegionAvail();
 
-      std::string name = entity.Get<TagComponent>().tag;
-      name.reserve(glm::max((int)name.size(), 64));
+      // name is set when edit is finished, not on every key: StringID keeps every set name
+      if (!nameEditing) {
+         nameEntity = entity;
+         std::string_view name = entity.GetName();
+         size_t size = std::min(name.size(), sizeof(nameBuffer) - 1);
+         std::memcpy(nameBuffer, name.data(), size);
+         nameBuffer[size] = '\0';
+      }
 
-      if (ImGui::InputText("##Name", name.data(), name.capacity())) {
-         entity.Get<TagComponent>().tag = name.c_str();
-         edited = true;
+      ImGui::InputText("##Name", nameBuffer, sizeof(nameBuffer));
+      nameEditing = ImGui::IsItemActive();
+
+      // selection may be changed by the same click, that finished edit
+      if (ImGui::IsItemDeactivatedAfterEdit() && nameEntity.Valid()) {
+         nameEntity.SetName(nameBuffer);
+         edited = nameEntity == entity;
       }
 
       float heightLine = ImGui::GetFrameHeight();
@@ -63,10 +73,11 @@ namespace pbe {
          return result;
       };
 
+      auto componentMask = typer.GetComponentMask(entity);
+
       if (UI_POPUP("Add Component Popup")) {
          for (const auto& ci : typer.components) {
-            auto* pComponent = ci.tryGet(entity);
-            if (!pComponent) {
+            if (!componentMask.test(ci.idx)) {
                auto processedName = processComponentName(typer.GetTypeInfo(ci.typeID).name);
                if (ImGui::MenuItem(processedName.data())) {
                   ci.getOrAdd(entity);
@@ -81,7 +92,7 @@ namespace pbe {
          edited |= EditorUI(entity.GetTransform());
       }
 
-      for (const auto& ci : typer.components) {
+      typer.ForEachComponent(componentMask, [&](const ComponentInfo& ci) {
          if (auto* pComponent = ci.tryGet(entity)) {
             const auto& ti = typer.GetTypeInfo(ci.typeID);
 
@@ -106,14 +117,13 @@ namespace pbe {
                   if (ci.onChanged) {
                      ci.onChanged(pComponent);
                   }
-                  if (entity.Enabled()) {
-                     ci.patch(entity);
-                  }
+                  // update handlers check enabled state themselves, change versions and journal see disabled too
+                  ci.patch(entity);
                   edited = true;
                }
             }
          }
-      }
+      });
 
       if (edited) {
          Undo::Get().PushSave();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "EditorWindow.h"
+#include "scene/Entity.h"
 
 namespace pbe {
 
@@ -12,6 +13,11 @@ namespace pbe {
       void OnWindowUI() override;
 
       EditorSelection* selection{};
+
+      // name of entity while it is edited
+      Entity nameEntity;
+      char nameBuffer[256] = {};
+      bool nameEditing = false;
    };
 
 }
@@ -14,7 +14,7 @@ namespace pbe {
    void SceneHierarchyWindow::DragDropChangeParent(const Entity& entity) {
       if (ui::DragDropTarget ddTarget{ DRAG_DROP_ENTITY }) {
          auto childEnt = *ddTarget.GetPayload<Entity>();
-         Undo::Get().SaveForFuture(childEnt); // todo: dont work
+         Undo::Get().SaveForFuture(childEnt);
          bool changed = childEnt.Get<SceneTransformComponent>().SetParent(entity); // todo: add to pending not in all case
          if (changed) {
             Undo::Get().PushSave();
@@ -37,6 +37,19 @@ namespace pbe {
             }
          }
 
+         ImGui::InputTextWithHint("##Search", "Search by name prefix", searchPrefix, sizeof(searchPrefix));
+
+         if (searchPrefix[0]) {
+            for (auto entity : scene.FindByNamePrefix(searchPrefix)) {
+               ImGui::PushID((void*)(uint64)entity.GetUUID());
+               if (ImGui::Selectable(entity.GetName(), selection && selection->IsSelected(entity))) {
+                  ToggleSelectEntity(entity);
+               }
+               ImGui::PopID();
+            }
+            return;
+         }
+
          UIEntity(pScene->GetRootEntity(), true);
 
          // place item for drag&drop to root
@@ -55,7 +68,7 @@ namespace pbe {
 
       const auto* name = std::invoke([&] {
          auto c = entity.TryGet<TagComponent>();
-         return c ? c->tag.data() : "Unnamed Entity";
+         return c ? c->tag.CStr() : "Unnamed Entity";
          });
 
       ImGuiTreeNodeFlags nodeFlags =
@@ -164,8 +177,11 @@ namespace pbe {
       }
 
       if (treeNode) {
-         for (auto child : trans.children) {
+         // child may be destroyed or reparented from its UI, so take next sibling before
+         for (Entity child = entity.GetTransform().FirstChild(); child; ) {
+            Entity next = child.GetTransform().NextSibling();
             UIEntity(child);
+            child = next;
          }
       }
    }
@@ -26,6 +26,8 @@ namespace pbe {
 
       Scene* pScene{};
       EditorSelection* selection{};
+
+      char searchPrefix[64] = {};
    };
 
 }
@@ -195,6 +195,9 @@ namespace pbe {
 
          cmd.SetCommonSamplers();
          if (scene) {
+            // editor changes since scene tick
+            scene->UpdateWorldTransforms();
+
             renderContext.cursorPixelIdx = cursorPixelPos;
 
             Entity e = scene->GetAnyWithComponent<CameraComponent>();
@@ -453,10 +456,6 @@ namespace pbe {
 
                   entity.GetTransform().SetScale(manipulatorRelativeTransform.scale * scale3);
                }
-
-               if (manipulatorMode & ObjManipulation) {
-                  entity.AddOrReplace<TransformChangedMarker>();
-               }
             }
          }
 
@@ -619,8 +618,6 @@ namespace pbe {
          if (gizmoCfg.operation & ImGuizmo::OPERATION::SCALE) {
             trans.SetScale(scale);
          }
-
-         selectedEntity.AddOrReplace<TransformChangedMarker>();
       }
    }
 
@@ -23,6 +23,10 @@ namespace pbe {
 
    class TestScript : public Script {
    public:
+      static SystemAccess GetAccess() {
+         return SystemAccess{}.Write<TestScript, SceneTransformComponent>();
+      }
+
       void OnEnable() override {
          INFO("OnEnable {}", GetName());
       }
@@ -34,7 +38,7 @@ namespace pbe {
       void OnUpdate(float dt) override {
          if (doMove) {
             auto& tran= owner.Get<SceneTransformComponent>();
-            tran.position.y += speed * dt;
+            tran.SetLocalPosition(tran.LocalPosition() + vec3_Y * speed * dt);
          }
       }
 